@@ -6,7 +6,7 @@
 for $file (<examples/*>){
 	if( $file =~ /proc(\d+)-c(\d+)-(\w+)\.out/){
 	#	print "Proc $1 CORE $2 Proc $3\n";
-		`./simulator -c $2 -s $3 examples/proc$1.csv | tail -7 > output1`;
+		`./simulator -c $2 -s $3 -v 0 examples/proc$1.csv | tail -7 > output1`;
 		`tail -7 $file > output2`;
 		$diff = `diff output1 output2`;
 		if($diff){
@@ -3,9 +3,26 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
 
 #include "libpriqueue.h"
 
+//x86 builds carry an AVX2 key search, used if the CPU running it has AVX2.
+//Build with -DPRIQUEUE_NO_SIMD to always use the scalar one
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(PRIQUEUE_NO_SIMD)
+#include <immintrin.h>
+#define PRIQUEUE_HAVE_AVX2 1
+#endif
+
+//sorted mode: batches of at least this many are sorted and merged in by
+//priqueue_offer_many() instead of offered one at a time
+#define SORTED_MERGE_MIN 16
+
+//keyed sorted mode: binary search narrows the insertion point down to
+//this many keys, which are then counted without branching
+#define SORTED_KEY_WINDOW 32
+
 
 /**
   Initializes the priqueue_t data structure.
@@ -18,6 +35,22 @@
   See also @ref comparer-page
  */
 void priqueue_init(priqueue_t *q, int(*comparer)(const void *, const void *))
+{
+	priqueue_init_mode(q, comparer, PRIQUEUE_SORTED);
+}
+
+
+/**
+  Initializes the priqueue_t data structure with an explicit storage layout.
+
+  Both layouts hand out elements in the same order: ascending by comparer,
+  and in insertion order among elements the comparer considers equal.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param comparer a function pointer that compares two elements.
+  @param mode the layout to keep the elements in, see priqueue_mode_t
+ */
+void priqueue_init_mode(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_mode_t mode)
 {
 	q->m_size = 64 ; //initialize at 64 because it's a good number
 	q->m_num_entries = 0; //currently empty
@@ -30,6 +63,492 @@ void priqueue_init(priqueue_t *q, int(*comparer)(const void *, const void *))
 	} //fill it with NULL
 	
 	q->compare_func = comparer;
+
+	q->m_mode = mode;
+	q->m_head = 0;
+	q->m_next_seq = 0;
+	q->m_seq = NULL;
+	q->m_handle = NULL;
+	q->m_handle_pos = NULL;
+	q->m_keys = NULL;
+	q->key_func = NULL;
+	if(PRIQUEUE_HEAP == mode)
+	{
+		q->m_seq = malloc(q->m_size * sizeof(*q->m_seq));
+		q->m_handle = malloc(q->m_size * sizeof(*q->m_handle));
+		q->m_handle_pos = malloc(q->m_size * sizeof(*q->m_handle_pos));
+		for(int x = 0; x < q->m_size; x++)
+		{
+			q->m_handle[x] = x;
+			q->m_handle_pos[x] = x;
+		}
+	}
+}
+
+
+/**
+  Initializes the priqueue_t data structure in PRIQUEUE_SORTED mode, ordered
+  by integer keys instead of a comparer: ascending by key, and in insertion
+  order among equal keys. priqueue_at(q, i) is still the i'th element in
+  that order, in O(1).
+
+  An element's key is taken once, when it is offered, and must not change
+  while it is in the queue.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param key a function pointer that returns the key of an element
+ */
+void priqueue_init_keyed(priqueue_t *q, unsigned long long(*key)(const void *))
+{
+	priqueue_init_mode(q, NULL, PRIQUEUE_SORTED);
+	q->key_func = key;
+	q->m_keys = malloc(q->m_size * sizeof(*q->m_keys));
+}
+
+
+/**
+  Initializes the priqueue_t data structure holding count elements to
+  start with, as if they had been offered one at a time in the order given
+  but in O(count) (PRIQUEUE_HEAP, PRIQUEUE_FIFO) or O(count log count)
+  (PRIQUEUE_SORTED). See priqueue_offer_many().
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param comparer a function pointer that compares two elements.
+  @param mode the layout to keep the elements in, see priqueue_mode_t
+  @param ptrs the elements to start with
+  @param count the number of elements in ptrs
+ */
+void priqueue_init_from_array(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_mode_t mode, void **ptrs, int count)
+{
+	priqueue_init_mode(q, comparer, mode);
+	priqueue_offer_many(q, ptrs, count);
+}
+
+
+/**
+  Grows the capacity of the queue to new_size, at least double the current
+  size. Entries past m_num_entries are left NULL so priqueue_at never hands
+  back stale pointers.
+ */
+static void priqueue_resize(priqueue_t *q, int new_size)
+{
+	q->m_array = realloc(q->m_array, new_size * sizeof(*q->m_array));
+	for(int y = q->m_size; y < new_size; y++)
+	{
+		q->m_array[y] = NULL;
+	}
+	if(PRIQUEUE_FIFO == q->m_mode && q->m_head > 0)
+	{
+		//the ring wrapped: move the wrapped front part (indices below
+		//m_head) to just after the old end so the entries are contiguous
+		for(int y = 0; y < q->m_head; y++)
+		{
+			q->m_array[q->m_size + y] = q->m_array[y];
+			q->m_array[y] = NULL;
+		}
+	}
+	if(NULL != q->m_keys)
+	{
+		q->m_keys = realloc(q->m_keys, new_size * sizeof(*q->m_keys));
+	}
+	if(NULL != q->m_seq)
+	{
+		q->m_seq = realloc(q->m_seq, new_size * sizeof(*q->m_seq));
+		q->m_handle = realloc(q->m_handle, new_size * sizeof(*q->m_handle));
+		q->m_handle_pos = realloc(q->m_handle_pos, new_size * sizeof(*q->m_handle_pos));
+		for(int y = q->m_size; y < new_size; y++)
+		{
+			//the new slots bring their own free handles
+			q->m_handle[y] = y;
+			q->m_handle_pos[y] = y;
+		}
+	}
+	q->m_size = new_size;
+}
+
+//doubles the capacity of the queue
+static void priqueue_grow(priqueue_t *q)
+{
+	priqueue_resize(q, 2 * q->m_size);
+}
+
+
+/**
+  Makes room for at least capacity elements up front, so that offering
+  that many takes no further allocations.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param capacity the number of elements to make room for
+ */
+void priqueue_reserve(priqueue_t *q, int capacity)
+{
+	//sorted mode grows as soon as it is full, so keep a spare slot
+	if(PRIQUEUE_SORTED == q->m_mode)
+	{
+		capacity = capacity + 1;
+	}
+	int new_size = q->m_size;
+	while(new_size < capacity)
+	{
+		new_size = 2 * new_size;
+	}
+	if(new_size != q->m_size)
+	{
+		priqueue_resize(q, new_size);
+	}
+}
+
+
+/**
+  Heap ordering: comparer first, then insertion sequence so that equal
+  elements come out in the order they were offered (what the sorted layout
+  does by scanning from the back).
+ */
+static int heap_less(priqueue_t *q, int a, int b)
+{
+	int result = q->compare_func(q->m_array[a], q->m_array[b]);
+	if(0 == result)
+	{
+		return(q->m_seq[a] < q->m_seq[b]);
+	}
+	return(0 > result);
+}
+
+static void heap_swap(priqueue_t *q, int a, int b)
+{
+	void *temp_ptr = q->m_array[a];
+	q->m_array[a] = q->m_array[b];
+	q->m_array[b] = temp_ptr;
+
+	unsigned long temp_seq = q->m_seq[a];
+	q->m_seq[a] = q->m_seq[b];
+	q->m_seq[b] = temp_seq;
+
+	int temp_handle = q->m_handle[a];
+	q->m_handle[a] = q->m_handle[b];
+	q->m_handle[b] = temp_handle;
+	q->m_handle_pos[q->m_handle[a]] = a;
+	q->m_handle_pos[q->m_handle[b]] = b;
+}
+
+//both sift functions return the index the element ended up at
+static int heap_sift_up(priqueue_t *q, int x)
+{
+	while(x > 0 && heap_less(q, x, (x - 1) / 2))
+	{
+		heap_swap(q, x, (x - 1) / 2);
+		x = (x - 1) / 2;
+	}
+	return(x);
+}
+
+static int heap_sift_down(priqueue_t *q, int x)
+{
+	while(1)
+	{
+		int smallest = x;
+		int left = 2 * x + 1;
+		int right = left + 1;
+		if(left < q->m_num_entries && heap_less(q, left, smallest))
+		{
+			smallest = left;
+		}
+		if(right < q->m_num_entries && heap_less(q, right, smallest))
+		{
+			smallest = right;
+		}
+		if(smallest == x)
+		{
+			return(x);
+		}
+		heap_swap(q, x, smallest);
+		x = smallest;
+	}
+}
+
+//moves the entry at index from to index to, overwriting what was there
+static void heap_move(priqueue_t *q, int from, int to)
+{
+	q->m_array[to] = q->m_array[from];
+	q->m_seq[to] = q->m_seq[from];
+	q->m_handle[to] = q->m_handle[from];
+	q->m_handle_pos[q->m_handle[to]] = to;
+}
+
+/**
+  heap_sift_down() for heap_build(). Most entries belong near the bottom,
+  so instead of comparing the entry against both children at every level,
+  the hole it leaves is walked down the smaller children to a leaf (one
+  comparison per level) and the entry is then sifted back up from there.
+ */
+static void heap_sift_down_bottom_up(priqueue_t *q, int x)
+{
+	void *ptr = q->m_array[x];
+	unsigned long seq = q->m_seq[x];
+	int handle = q->m_handle[x];
+
+	int hole = x;
+	while(2 * hole + 1 < q->m_num_entries)
+	{
+		int child = 2 * hole + 1;
+		if(child + 1 < q->m_num_entries && heap_less(q, child + 1, child))
+		{
+			child++;
+		}
+		heap_move(q, child, hole);
+		hole = child;
+	}
+
+	while(hole > x)
+	{
+		int parent = (hole - 1) / 2;
+		int result = q->compare_func(ptr, q->m_array[parent]);
+		if(0 < result || (0 == result && seq > q->m_seq[parent]))
+		{
+			break; //the parent still comes first
+		}
+		heap_move(q, parent, hole);
+		hole = parent;
+	}
+
+	q->m_array[hole] = ptr;
+	q->m_seq[hole] = seq;
+	q->m_handle[hole] = handle;
+	q->m_handle_pos[handle] = hole;
+}
+
+//restores the heap property over the whole array in O(n)
+static void heap_build(priqueue_t *q)
+{
+	for(int x = q->m_num_entries / 2 - 1; x >= 0; x--)
+	{
+		heap_sift_down_bottom_up(q, x);
+	}
+}
+
+//number of keys[0..count) that are <= key
+static int sorted_key_count(const unsigned long long *keys, int count, unsigned long long key)
+{
+	int result = 0;
+	for(int x = 0; x < count; x++)
+	{
+		result += (keys[x] <= key);
+	}
+	return(result);
+}
+
+#ifdef PRIQUEUE_HAVE_AVX2
+//sorted_key_count() four keys at a time
+__attribute__((target("avx2")))
+static int sorted_key_count_avx2(const unsigned long long *keys, int count, unsigned long long key)
+{
+	//AVX2 only compares signed lanes, so flip every sign bit first
+	const __m256i flip = _mm256_set1_epi64x(LLONG_MIN);
+	__m256i wanted = _mm256_xor_si256(_mm256_set1_epi64x((long long)key), flip);
+	int greater = 0;
+	int x = 0;
+	for(; x + 4 <= count; x += 4)
+	{
+		__m256i lanes = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(keys + x)), flip);
+		__m256i mask = _mm256_cmpgt_epi64(lanes, wanted);
+		greater += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(mask)));
+	}
+	return(x - greater + sorted_key_count(keys + x, count - x, key));
+}
+#endif
+
+//keyed sorted mode: the index an element with key goes in at, after any
+//equal keys so ties stay in insertion order
+static int sorted_key_slot(priqueue_t *q, unsigned long long key)
+{
+	//the answer is in [low, high]
+	int low = 0;
+	int high = q->m_num_entries;
+	while(high - low > SORTED_KEY_WINDOW)
+	{
+		int mid = low + (high - low) / 2;
+		if(q->m_keys[mid] <= key)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	//the last few halvings would be mispredicted branches; counting the
+	//window's keys that are <= key gives the same answer without any
+#ifdef PRIQUEUE_HAVE_AVX2
+	if(__builtin_cpu_supports("avx2"))
+	{
+		return(low + sorted_key_count_avx2(q->m_keys + low, high - low, key));
+	}
+#endif
+	return(low + sorted_key_count(q->m_keys + low, high - low, key));
+}
+
+//keyed sorted mode: makes room at index x by moving entries x.. up one
+static void sorted_open(priqueue_t *q, int x)
+{
+	memmove(&q->m_array[x + 1], &q->m_array[x], (q->m_num_entries - x) * sizeof(*q->m_array));
+	if(NULL != q->m_keys)
+	{
+		memmove(&q->m_keys[x + 1], &q->m_keys[x], (q->m_num_entries - x) * sizeof(*q->m_keys));
+	}
+}
+
+//sorted mode: removes count entries starting at index x, moving the ones
+//after them down and NULLing the freed slots at the end
+static void sorted_close(priqueue_t *q, int x, int count)
+{
+	int after = q->m_num_entries - x - count;
+	memmove(&q->m_array[x], &q->m_array[x + count], after * sizeof(*q->m_array));
+	if(NULL != q->m_keys)
+	{
+		memmove(&q->m_keys[x], &q->m_keys[x + count], after * sizeof(*q->m_keys));
+	}
+	for(int y = q->m_num_entries - count; y < q->m_num_entries; y++)
+	{
+		q->m_array[y] = NULL;
+	}
+	q->m_num_entries = q->m_num_entries - count;
+}
+
+//an element on its way into a sorted queue (key unused without m_keys)
+typedef struct _sorted_entry_t
+{
+	unsigned long long key;
+	void *ptr;
+} sorted_entry_t;
+
+//sorted mode: whether a belongs strictly before b
+static int sorted_before(priqueue_t *q, const sorted_entry_t *a, const sorted_entry_t *b)
+{
+	if(NULL != q->m_keys)
+	{
+		return(a->key < b->key);
+	}
+	return(0 > q->compare_func(a->ptr, b->ptr));
+}
+
+//stable bottom-up merge sort of entries[0..count), using scratch (just as
+//large) to merge into
+static void sorted_entries_sort(priqueue_t *q, sorted_entry_t *entries, sorted_entry_t *scratch, int count)
+{
+	sorted_entry_t *from = entries;
+	sorted_entry_t *to = scratch;
+	for(int width = 1; width < count; width = 2 * width)
+	{
+		for(int low = 0; low < count; low = low + 2 * width)
+		{
+			int mid = (low + width < count) ? low + width : count;
+			int high = (low + 2 * width < count) ? low + 2 * width : count;
+			int a = low;
+			int b = mid;
+			int k = low;
+			while(a < mid && b < high)
+			{
+				//ties take the left run first, so equal entries keep
+				//their order
+				if(sorted_before(q, &from[b], &from[a]))
+				{
+					to[k++] = from[b++];
+				}
+				else
+				{
+					to[k++] = from[a++];
+				}
+			}
+			while(a < mid)
+			{
+				to[k++] = from[a++];
+			}
+			while(b < high)
+			{
+				to[k++] = from[b++];
+			}
+		}
+		sorted_entry_t *temp = from;
+		from = to;
+		to = temp;
+	}
+	if(from != entries)
+	{
+		memcpy(entries, from, count * sizeof(*entries));
+	}
+}
+
+/**
+  Sorted mode priqueue_offer_many(): sorts the batch, then merges it into
+  m_array from the back, in O(n + count log count) rather than the
+  O(n * count) of offering each one. Equal elements end up where one offer
+  at a time would put them: existing ones first, then the batch in order.
+ */
+static void sorted_merge_many(priqueue_t *q, void **ptrs, int count)
+{
+	sorted_entry_t *batch = malloc(2 * (size_t)count * sizeof(*batch));
+	for(int x = 0; x < count; x++)
+	{
+		batch[x].ptr = ptrs[x];
+		batch[x].key = (NULL != q->m_keys) ? q->key_func(ptrs[x]) : 0;
+	}
+	sorted_entries_sort(q, batch, batch + count, count);
+
+	priqueue_reserve(q, q->m_num_entries + count);
+	int a = q->m_num_entries - 1;
+	int b = count - 1;
+	for(int k = q->m_num_entries + count - 1; b >= 0; k--)
+	{
+		sorted_entry_t existing;
+		if(a >= 0)
+		{
+			existing.ptr = q->m_array[a];
+			existing.key = (NULL != q->m_keys) ? q->m_keys[a] : 0;
+		}
+		//a batch element goes after every existing one it does not
+		//belong strictly before
+		sorted_entry_t *next = (a >= 0 && sorted_before(q, &batch[b], &existing)) ? &existing : &batch[b--];
+		if(next == &existing)
+		{
+			a--;
+		}
+		q->m_array[k] = next->ptr;
+		if(NULL != q->m_keys)
+		{
+			q->m_keys[k] = next->key;
+		}
+	}
+	q->m_num_entries = q->m_num_entries + count;
+	free(batch);
+}
+
+//maps a queue position to its slot in the fifo ring
+static int fifo_slot(priqueue_t *q, int index)
+{
+	int slot = q->m_head + index;
+	if(slot >= q->m_size)
+	{
+		slot = slot - q->m_size;
+	}
+	return(slot);
+}
+
+//removes the entry at heap index x by swapping the last entry into its
+//place; the removed entry's handle lands past m_num_entries and is freed
+static void *heap_remove_at(priqueue_t *q, int x)
+{
+	void *removed_value = q->m_array[x];
+	int last = q->m_num_entries - 1;
+
+	heap_swap(q, x, last);
+	q->m_array[last] = NULL;
+	q->m_num_entries = last;
+
+	if(x < last && heap_sift_up(q, x) == x)
+	{
+		heap_sift_down(q, x);
+	}
+	return(removed_value);
 }
 
 
@@ -39,9 +558,51 @@ void priqueue_init(priqueue_t *q, int(*comparer)(const void *, const void *))
   @param q a pointer to an instance of the priqueue_t data structure
   @param ptr a pointer to the data to be inserted into the priority queue
   @return The zero-based index where ptr is stored in the priority queue, where 0 indicates that ptr was stored at the front of the priority queue.
+  @return In PRIQUEUE_HEAP mode, a handle for ptr instead, usable with
+  priqueue_remove_handle() and priqueue_update_key() until ptr leaves the
+  queue. Handles of removed elements are reused.
  */
 int priqueue_offer(priqueue_t *q, void *ptr)
 {
+	if(PRIQUEUE_HEAP == q->m_mode)
+	{
+		if(q->m_num_entries == q->m_size)
+		{
+			priqueue_grow(q);
+		}
+		int x = q->m_num_entries;
+		q->m_array[x] = ptr;
+		q->m_seq[x] = q->m_next_seq++;
+		q->m_num_entries = x + 1;
+		int handle = q->m_handle[x];
+		heap_sift_up(q, x);
+		return(handle);
+	}
+	else if(PRIQUEUE_FIFO == q->m_mode)
+	{
+		if(q->m_num_entries == q->m_size)
+		{
+			priqueue_grow(q);
+		}
+		q->m_array[fifo_slot(q, q->m_num_entries)] = ptr;
+		q->m_num_entries = q->m_num_entries + 1;
+		return(q->m_num_entries - 1);
+	}
+	else if(NULL != q->m_keys)
+	{
+		unsigned long long key = q->key_func(ptr);
+		int x = sorted_key_slot(q, key);
+		sorted_open(q, x);
+		q->m_array[x] = ptr;
+		q->m_keys[x] = key;
+		q->m_num_entries = q->m_num_entries + 1;
+
+		if(q->m_num_entries == q->m_size)
+		{
+			priqueue_grow(q);
+		}
+		return(x);
+	}
 	
 	//start at back of queue	
 	if(0 == q->m_num_entries)
@@ -72,31 +633,14 @@ int priqueue_offer(priqueue_t *q, void *ptr)
 		//This means that ptr should be inserted immediately after x
 
 		//first relocate necessary elements
-		for( int z = q->m_num_entries-1 ; z > x ; z--)
-		{
-			q->m_array[z+1] = q->m_array[z]; //move up an index
-		}
+		sorted_open(q, x+1);
 		q->m_array[x+1] = ptr;
 		q->m_num_entries = q->m_num_entries + 1; //increment number of entries
 
 		if(q->m_num_entries == q->m_size)
 		{
-			//Refactor / double size of array
-			void ** replacement_array = malloc(2 * sizeof(*q->m_array) );
-			int y;
-			for( y = 0; y < 2 * q->m_num_entries; y++)
-			{
-				replacement_array[y] = NULL; //set all entries to NULL
-			}
-			for( y = 0; y < q->m_num_entries; y++)
-			{
-				//duplicate necessary entries from the old array
-				replacement_array[y] = q->m_array[y]; 
-
-			}
-			free(q->m_array); //free old array
-			q->m_array = replacement_array; //replace with new, larger array
-			q->m_size = 2*q->m_size; //double m_size
+			//double size of array
+			priqueue_grow(q);
 		}
 		return(x+1); //x+1 is index of inserted pointer
 	}
@@ -106,6 +650,82 @@ int priqueue_offer(priqueue_t *q, void *ptr)
 }
 
 
+/**
+  Inserts count elements at once. They are handed out exactly as if they
+  had been offered one at a time in the order given.
+
+  In PRIQUEUE_HEAP mode the batch is appended and sifted up, switching to
+  an O(n) rebuild of the heap when sifting turns out to cost more, so a
+  batch never takes more than O(n + count). Into an empty queue it builds
+  the heap in O(count) straight away. No handles are returned, though the
+  elements still get them.
+  In PRIQUEUE_SORTED mode a batch of more than a few elements is sorted
+  and merged in, in O(n + count log count).
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptrs the elements to insert
+  @param count the number of elements in ptrs
+ */
+void priqueue_offer_many(priqueue_t *q, void **ptrs, int count)
+{
+	if(PRIQUEUE_HEAP == q->m_mode)
+	{
+		int old_entries = q->m_num_entries;
+		priqueue_reserve(q, old_entries + count);
+		for(int x = 0; x < count; x++)
+		{
+			//sequence numbers still follow the order given, so ties
+			//come out the same either way
+			q->m_array[old_entries + x] = ptrs[x];
+			q->m_seq[old_entries + x] = q->m_next_seq++;
+		}
+		q->m_num_entries = old_entries + count;
+		if(0 == old_entries)
+		{
+			heap_build(q);
+			return;
+		}
+
+		//sifting each one up is O(1) on average for keys that come in
+		//random (about 1.6 levels each) or ascending order, but O(log n)
+		//each when they come in descending order. Once the levels climbed
+		//pass what rebuilding the heap would cost (about two per entry),
+		//rebuild it instead
+		long long levels = 0;
+		for(int x = old_entries; x < q->m_num_entries; x++)
+		{
+			int moved_to = heap_sift_up(q, x);
+			levels += __builtin_clz(moved_to + 1) - __builtin_clz(x + 1);
+			if(levels > 2LL * q->m_num_entries)
+			{
+				heap_build(q);
+				break;
+			}
+		}
+	}
+	else if(PRIQUEUE_FIFO == q->m_mode)
+	{
+		priqueue_reserve(q, q->m_num_entries + count);
+		for(int x = 0; x < count; x++)
+		{
+			q->m_array[fifo_slot(q, q->m_num_entries + x)] = ptrs[x];
+		}
+		q->m_num_entries = q->m_num_entries + count;
+	}
+	else if(count >= SORTED_MERGE_MIN)
+	{
+		sorted_merge_many(q, ptrs, count);
+	}
+	else
+	{
+		for(int x = 0; x < count; x++)
+		{
+			priqueue_offer(q, ptrs[x]);
+		}
+	}
+}
+
+
 /**
   Retrieves, but does not remove, the head of this queue, returning NULL if
   this queue is empty.
@@ -122,6 +742,10 @@ void *priqueue_peek(priqueue_t *q)
 	}
 	else if(0 < q->m_size)
 	{
+		if(PRIQUEUE_FIFO == q->m_mode)
+		{
+			return(q->m_array[q->m_head]);
+		}
 		return(q->m_array[0]); //returns front of queue
 	}
 	else
@@ -147,22 +771,24 @@ void *priqueue_poll(priqueue_t *q)
 	{//is empty
 		return NULL;
 	}
+	else if(PRIQUEUE_HEAP == q->m_mode)
+	{
+		return(heap_remove_at(q, 0));
+	}
+	else if(PRIQUEUE_FIFO == q->m_mode)
+	{
+		void *temp = q->m_array[q->m_head];
+		q->m_array[q->m_head] = NULL;
+		q->m_head = fifo_slot(q, 1);
+		q->m_num_entries = q->m_num_entries - 1;
+		return(temp);
+	}
 	else if( 0 < q->m_size)
 	{
 		void *temp = q->m_array[0];
-		for(int x=0; x < q->m_num_entries ; x++)
-		{
-			if( x == q->m_size - 1) //if x is the very last entry,
-						//and the queue was full
-			{
-				break;
-			}
-			q->m_array[x] = q->m_array[x+1];
-		}
-		q->m_array[ q->m_num_entries - 1 ] = NULL;
-		//sets last entry (formerly a pointer) to NULL
-		q->m_num_entries = q->m_num_entries - 1;
-		//decrements the recorded number of entries
+		//move everything else up a spot, NULLing the old last entry
+		//and decrementing the recorded number of entries
+		sorted_close(q, 0, 1);
 		return(temp);
 	}
 	return(NULL);
@@ -172,6 +798,9 @@ void *priqueue_poll(priqueue_t *q)
 /**
   Returns the element at the specified position in this list, or NULL if
   the queue does not contain an index'th element.
+
+  In PRIQUEUE_HEAP mode positions follow the heap layout, so only index 0
+  is guaranteed to be the head of the queue.
  
   @param q a pointer to an instance of the priqueue_t data structure
   @param index position of retrieved element
@@ -180,10 +809,14 @@ void *priqueue_poll(priqueue_t *q)
  */
 void *priqueue_at(priqueue_t *q, int index)
 {
-	if(index > q->m_num_entries)
+	if(index < 0 || index >= q->m_num_entries)
 	{
 		return(NULL);
 	}
+	else if(PRIQUEUE_FIFO == q->m_mode)
+	{
+		return(q->m_array[fifo_slot(q, index)]);
+	}
 	else
 	{
 		return(q->m_array[index]);
@@ -211,6 +844,48 @@ int priqueue_remove(priqueue_t *q, void *ptr)
 	{
 		return(0);
 	}
+	else if(PRIQUEUE_HEAP == q->m_mode)
+	{
+		//swap every instance out past the end, then rebuild the heap in
+		//one pass. Walking backwards means whatever gets swapped into x
+		//has already been checked
+		for(int x = q->m_num_entries - 1; x >= 0; x--)
+		{
+			if(q->m_array[x] == ptr)
+			{
+				heap_swap(q, x, q->m_num_entries - 1);
+				q->m_array[q->m_num_entries - 1] = NULL;
+				q->m_num_entries = q->m_num_entries - 1;
+				number_of_instances++;
+			}
+		}
+		if(number_of_instances > 0)
+		{
+			heap_build(q);
+		}
+		return(number_of_instances);
+	}
+	else if(PRIQUEUE_FIFO == q->m_mode)
+	{
+		//compact the ring in place, keeping the survivors in order
+		int kept = 0;
+		for(int x = 0; x < q->m_num_entries; x++)
+		{
+			void *entry = q->m_array[fifo_slot(q, x)];
+			if(entry != ptr)
+			{
+				q->m_array[fifo_slot(q, kept)] = entry;
+				kept++;
+			}
+		}
+		for(int x = kept; x < q->m_num_entries; x++)
+		{
+			q->m_array[fifo_slot(q, x)] = NULL;
+		}
+		number_of_instances = q->m_num_entries - kept;
+		q->m_num_entries = kept;
+		return(number_of_instances);
+	}
 	else
 	{
 		int x = 0;
@@ -236,23 +911,10 @@ int priqueue_remove(priqueue_t *q, void *ptr)
 				x++;
 				number_of_instances++;
 			}
-			for(int y = first_location;
-			    y < q->m_num_entries - number_of_instances;
-			    y++)
-			{
-				//Move all at and past first appearance point
-				//back number_of_instance spaces
-				q->m_array[y] = q->m_array[ y + number_of_instances];
-			}
-			for(int y = q->m_num_entries - number_of_instances; 
-			    y < q->m_num_entries;
-			    y++)
-			{
-				//Replace last number_of_instance spots with
-				//NULL
-				q->m_array[y] = NULL;
-			}
-			q->m_num_entries = q->m_num_entries - number_of_instances;
+			//Move all past the last appearance back
+			//number_of_instance spaces, and replace the last
+			//number_of_instance spots with NULL
+			sorted_close(q, first_location, number_of_instances);
 
 			return(number_of_instances);
 		}
@@ -274,21 +936,31 @@ int priqueue_remove(priqueue_t *q, void *ptr)
  */
 void *priqueue_remove_at(priqueue_t *q, int index)
 {
-	if(index > q->m_num_entries)
+	if(index < 0 || index >= q->m_num_entries)
 	{
 		return(NULL);
 	}
-	else
+	else if(PRIQUEUE_HEAP == q->m_mode)
 	{
-		void* removed_value = q->m_array[index];
-		int x = index;
-		while( x < q->m_num_entries)
+		return(heap_remove_at(q, index));
+	}
+	else if(PRIQUEUE_FIFO == q->m_mode)
+	{
+		void* removed_value = q->m_array[fifo_slot(q, index)];
+		for(int x = index; x < q->m_num_entries - 1; x++)
 		{
-			//shuffle all entries after "index" back one
-			q->m_array[x] = q->m_array[x+1];
+			q->m_array[fifo_slot(q, x)] = q->m_array[fifo_slot(q, x + 1)];
 		}
-		q->m_array[ q->m_num_entries - 1 ] = NULL; //make last entry NULL
-		q->m_num_entries = q->m_num_entries - 1; //decrement m_num_entries
+		q->m_array[fifo_slot(q, q->m_num_entries - 1)] = NULL;
+		q->m_num_entries = q->m_num_entries - 1;
+		return(removed_value);
+	}
+	else
+	{
+		void* removed_value = q->m_array[index];
+		//shuffle all entries after "index" back one, make last entry
+		//NULL and decrement m_num_entries
+		sorted_close(q, index, 1);
 		return(removed_value);
 	}
 
@@ -296,6 +968,60 @@ void *priqueue_remove_at(priqueue_t *q, int index)
 }
 
 
+/**
+  Removes the element a PRIQUEUE_HEAP mode priqueue_offer() returned handle
+  for, in O(log n).
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle the handle returned when the element was offered
+  @return the element removed from the queue
+  @return NULL if handle does not refer to an element in the queue
+ */
+void *priqueue_remove_handle(priqueue_t *q, int handle)
+{
+	if(PRIQUEUE_HEAP != q->m_mode || handle < 0 || handle >= q->m_size)
+	{
+		return(NULL);
+	}
+	int index = q->m_handle_pos[handle];
+	if(index >= q->m_num_entries)
+	{
+		return(NULL); //handle is free
+	}
+	return(heap_remove_at(q, index));
+}
+
+
+/**
+  Restores the element's place in the queue after the caller changed the
+  fields its comparer looks at, in O(log n). Its place among equal elements
+  still follows the order it was originally offered in.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle the handle returned when the element was offered
+  @return the zero-based index the element is now stored at
+  @return -1 if handle does not refer to an element in the queue
+ */
+int priqueue_update_key(priqueue_t *q, int handle)
+{
+	if(PRIQUEUE_HEAP != q->m_mode || handle < 0 || handle >= q->m_size)
+	{
+		return(-1);
+	}
+	int index = q->m_handle_pos[handle];
+	if(index >= q->m_num_entries)
+	{
+		return(-1);
+	}
+	int moved_to = heap_sift_up(q, index);
+	if(moved_to == index)
+	{
+		moved_to = heap_sift_down(q, index);
+	}
+	return(moved_to);
+}
+
+
 /**
   Returns the number of elements in the queue.
  
@@ -316,5 +1042,9 @@ int priqueue_size(priqueue_t *q)
 void priqueue_destroy(priqueue_t *q)
 {
 	free(q->m_array);
+	free(q->m_seq);
+	free(q->m_handle);
+	free(q->m_handle_pos);
+	free(q->m_keys);
 //	free(q);
 }
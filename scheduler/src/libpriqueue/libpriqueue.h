@@ -3,8 +3,30 @@
 
 #ifndef LIBPRIQUEUE_H_
 #define LIBPRIQUEUE_H_
+
+#include <stdlib.h>
+
 #define MAX_QUEUE_SIZE 128
 
+/**
+  Storage layouts available to a priqueue_t.
+
+  PRIQUEUE_SORTED keeps m_array in priority order (O(n) offer/poll, O(1)
+  ordered priqueue_at). PRIQUEUE_HEAP keeps m_array as a binary min-heap
+  (O(log n) offer/poll, priqueue_at walks storage order, not priority order).
+  PRIQUEUE_FIFO keeps m_array as a ring buffer in offer order and never
+  calls the comparer (O(1) offer/poll); only use it when the comparer would
+  return 0 or already agrees with offer order.
+
+  A PRIQUEUE_SORTED queue made by priqueue_init_keyed() orders by integer
+  keys kept in an array beside m_array instead, so finding where an offer
+  goes is a search over contiguous keys rather than comparer calls. A
+  PRIQUEUE_SORTED queue made with a comparer still scans back from the end
+  for where an offer goes (only the shifting is done with memmove()); make
+  it keyed to get the faster search.
+*/
+typedef enum {PRIQUEUE_SORTED = 0, PRIQUEUE_HEAP, PRIQUEUE_FIFO} priqueue_mode_t;
+
 /**
   Priqueue Data Structure
 */
@@ -23,6 +45,24 @@ typedef struct _priqueue_t
 	int(*compare_func)(const void *, const void *);
 
 	void ** m_array;
+	//which layout m_array is kept in
+	priqueue_mode_t m_mode;
+	//heap mode only: insertion sequence number of each m_array entry,
+	//used to break comparator ties so equal elements stay FIFO
+	unsigned long * m_seq;
+	//sequence number handed to the next offered element
+	unsigned long m_next_seq;
+	//heap mode only: m_handle[i] is the handle of the entry at index i and
+	//m_handle_pos[h] is the index of handle h. m_handle is a permutation of
+	//0..m_size-1, so the handles past m_num_entries are the free ones
+	int * m_handle;
+	int * m_handle_pos;
+	//fifo mode only: index in m_array of the head of the ring
+	int m_head;
+	//sorted mode made by priqueue_init_keyed() only (NULL otherwise):
+	//m_keys[i] is key_func(m_array[i]), so m_keys is ascending too
+	unsigned long long * m_keys;
+	unsigned long long(*key_func)(const void *);
 	//Array of void pointers?
 	//could just make it a fixed, large size.
 	//(like 128 or something)
@@ -34,15 +74,248 @@ typedef struct _priqueue_t
 
 
 void   priqueue_init     (priqueue_t *q, int(*comparer)(const void *, const void *));
+void   priqueue_init_mode(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_mode_t mode);
+void   priqueue_init_keyed(priqueue_t *q, unsigned long long(*key)(const void *));
+void   priqueue_init_from_array(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_mode_t mode, void **ptrs, int count);
+void   priqueue_reserve  (priqueue_t *q, int capacity);
 
 int    priqueue_offer    (priqueue_t *q, void *ptr);
+void   priqueue_offer_many(priqueue_t *q, void **ptrs, int count);
 void * priqueue_peek     (priqueue_t *q);
 void * priqueue_poll     (priqueue_t *q);
 void * priqueue_at       (priqueue_t *q, int index);
 int    priqueue_remove   (priqueue_t *q, void *ptr);
 void * priqueue_remove_at(priqueue_t *q, int index);
+void * priqueue_remove_handle(priqueue_t *q, int handle);
+int    priqueue_update_key   (priqueue_t *q, int handle);
 int    priqueue_size     (priqueue_t *q);
 
 void   priqueue_destroy  (priqueue_t *q);
 
+
+/**
+  PRIQUEUE_DEFINE_TYPED(name, type, compare) defines name_t, a binary
+  min-heap of type pointers that hands elements out in the same order as a
+  PRIQUEUE_HEAP priqueue_t with compare as its comparer: ascending by
+  compare, and in offer order among equal elements.
+
+  compare is called as compare(const type *a, const type *b) and returns
+  <0, 0 or >0 like a comparer. Everything the macro defines is static
+  inline, so compare (a macro or a static inline function) gets inlined
+  into the sift loops instead of being called through a pointer once per
+  comparison. The price is that there are no handles, removes or
+  priqueue_at; use priqueue_t where those are needed.
+
+  PRIQUEUE_DEFINE_KEYED(name, type, key) defines the same thing, but the
+  order comes from key(const type *ptr), an unsigned long long: ascending
+  by key, then offer order. The key is worked out once when an element is
+  offered and stored beside its pointer, so sifting only compares integers
+  in the heap's own array and never touches the elements. An element's key
+  must not change while it is queued; pack any tiebreak into its low bits.
+
+  It defines, all static inline:
+    void    name_init      (name_t *q);
+    void    name_destroy   (name_t *q);
+    void    name_offer     (name_t *q, type *ptr);
+    void    name_offer_many(name_t *q, type **ptrs, int count);
+    void    name_reserve   (name_t *q, int capacity);
+    type *  name_peek      (name_t *q);
+    type *  name_poll      (name_t *q);
+    int     name_size      (name_t *q);
+  which work like their priqueue_* counterparts.
+*/
+#define PRIQUEUE_DEFINE_TYPED(name, type, compare) \
+\
+typedef struct \
+{ \
+	type *ptr; \
+	/* offer sequence number, breaks compare ties so they stay FIFO */ \
+	unsigned long seq; \
+} name##_entry_t; \
+\
+static inline void name##_entry_set(name##_entry_t *entry, type *ptr) \
+{ \
+	entry->ptr = ptr; \
+} \
+\
+static inline int name##_less(const name##_entry_t *a, const name##_entry_t *b) \
+{ \
+	int result = compare(a->ptr, b->ptr); \
+	if(0 == result) \
+	{ \
+		return(a->seq < b->seq); \
+	} \
+	return(0 > result); \
+} \
+\
+PRIQUEUE_DEFINE_HEAP_(name, type)
+
+#define PRIQUEUE_DEFINE_KEYED(name, type, key) \
+\
+typedef struct \
+{ \
+	unsigned long long key; \
+	/* offer sequence number, breaks key ties so they stay FIFO */ \
+	unsigned long seq; \
+	type *ptr; \
+} name##_entry_t; \
+\
+static inline void name##_entry_set(name##_entry_t *entry, type *ptr) \
+{ \
+	entry->key = key(ptr); \
+	entry->ptr = ptr; \
+} \
+\
+static inline int name##_less(const name##_entry_t *a, const name##_entry_t *b) \
+{ \
+	return(a->key < b->key || (a->key == b->key && a->seq < b->seq)); \
+} \
+\
+PRIQUEUE_DEFINE_HEAP_(name, type)
+
+/* the heap itself, shared by both: needs name_entry_t, name_entry_set() \
+   and name_less() */
+#define PRIQUEUE_DEFINE_HEAP_(name, type) \
+\
+typedef struct \
+{ \
+	int m_size; \
+	int m_num_entries; \
+	name##_entry_t *m_array; \
+	unsigned long m_next_seq; \
+} name##_t; \
+\
+static inline void name##_init(name##_t *q) \
+{ \
+	q->m_size = 64; \
+	q->m_num_entries = 0; \
+	q->m_array = malloc(q->m_size * sizeof(*q->m_array)); \
+	q->m_next_seq = 0; \
+} \
+\
+static inline void name##_destroy(name##_t *q) \
+{ \
+	free(q->m_array); \
+} \
+\
+static inline void name##_reserve(name##_t *q, int capacity) \
+{ \
+	if(q->m_size < capacity) \
+	{ \
+		while(q->m_size < capacity) \
+		{ \
+			q->m_size = 2 * q->m_size; \
+		} \
+		q->m_array = realloc(q->m_array, q->m_size * sizeof(*q->m_array)); \
+	} \
+} \
+\
+/* moves entry up from the hole at x to where it belongs and puts it there, \
+   returning that index */ \
+static inline int name##_sift_up(name##_t *q, int x, name##_entry_t entry) \
+{ \
+	while(x > 0 && name##_less(&entry, &q->m_array[(x - 1) / 2])) \
+	{ \
+		q->m_array[x] = q->m_array[(x - 1) / 2]; \
+		x = (x - 1) / 2; \
+	} \
+	q->m_array[x] = entry; \
+	return(x); \
+} \
+\
+/* puts entry in the subheap rooted at the hole at x. It most likely \
+   belongs near the bottom, so the hole is walked down the smaller \
+   children to a leaf first (one comparison per level) and entry is \
+   sifted back up from there */ \
+static inline void name##_sift_down(name##_t *q, int x, name##_entry_t entry) \
+{ \
+	int hole = x; \
+	while(2 * hole + 1 < q->m_num_entries) \
+	{ \
+		int child = 2 * hole + 1; \
+		if(child + 1 < q->m_num_entries && name##_less(&q->m_array[child + 1], &q->m_array[child])) \
+		{ \
+			child++; \
+		} \
+		q->m_array[hole] = q->m_array[child]; \
+		hole = child; \
+	} \
+	while(hole > x && name##_less(&entry, &q->m_array[(hole - 1) / 2])) \
+	{ \
+		q->m_array[hole] = q->m_array[(hole - 1) / 2]; \
+		hole = (hole - 1) / 2; \
+	} \
+	q->m_array[hole] = entry; \
+} \
+\
+static inline void name##_offer(name##_t *q, type *ptr) \
+{ \
+	name##_reserve(q, q->m_num_entries + 1); \
+	name##_entry_t entry; \
+	name##_entry_set(&entry, ptr); \
+	entry.seq = q->m_next_seq++; \
+	q->m_num_entries = q->m_num_entries + 1; \
+	name##_sift_up(q, q->m_num_entries - 1, entry); \
+} \
+\
+/* sifts up like priqueue_offer_many(), rebuilding the heap instead once \
+   that gets more expensive or when it started out empty */ \
+static inline void name##_offer_many(name##_t *q, type **ptrs, int count) \
+{ \
+	int old_entries = q->m_num_entries; \
+	name##_reserve(q, old_entries + count); \
+	for(int x = 0; x < count; x++) \
+	{ \
+		name##_entry_set(&q->m_array[old_entries + x], ptrs[x]); \
+		q->m_array[old_entries + x].seq = q->m_next_seq++; \
+	} \
+	q->m_num_entries = old_entries + count; \
+\
+	/* an empty heap skips straight to the rebuild */ \
+	int x = old_entries; \
+	long long levels = 0; \
+	while(0 < old_entries && x < q->m_num_entries && levels <= 2LL * q->m_num_entries) \
+	{ \
+		int moved_to = name##_sift_up(q, x, q->m_array[x]); \
+		levels += __builtin_clz(moved_to + 1) - __builtin_clz(x + 1); \
+		x++; \
+	} \
+	if(x < q->m_num_entries) \
+	{ \
+		for(int y = q->m_num_entries / 2 - 1; y >= 0; y--) \
+		{ \
+			name##_sift_down(q, y, q->m_array[y]); \
+		} \
+	} \
+} \
+\
+static inline type *name##_peek(name##_t *q) \
+{ \
+	if(0 == q->m_num_entries) \
+	{ \
+		return(NULL); \
+	} \
+	return(q->m_array[0].ptr); \
+} \
+\
+static inline type *name##_poll(name##_t *q) \
+{ \
+	if(0 == q->m_num_entries) \
+	{ \
+		return(NULL); \
+	} \
+	type *head = q->m_array[0].ptr; \
+	q->m_num_entries = q->m_num_entries - 1; \
+	if(0 < q->m_num_entries) \
+	{ \
+		name##_sift_down(q, 0, q->m_array[q->m_num_entries]); \
+	} \
+	return(head); \
+} \
+\
+static inline int name##_size(name##_t *q) \
+{ \
+	return(q->m_num_entries); \
+}
+
 #endif /* LIBPQUEUE_H_ */
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include "libscheduler.h"
 #include "../libpriqueue/libpriqueue.h"
@@ -30,10 +31,17 @@ typedef struct _job_t
 				 //-1 for never scheduled yet
 	int time_first_scheduled;//self-explanatory, used to calculate response time
 				 //-1 for never scheduled yet
+	int running_handle; //handle in running_queue while on a core
+			    //(PSJF and PPRI only)
+	int level; //MLFQ only: current level, 0 being the highest
+	int weight; //CFS only: share of the cores, from priority
+	int cfs_slice; //CFS only: quantum it got when last put on a core
+	long long vruntime; //CFS only: time run, scaled down by weight. Only
+			    //brought up to date when the job leaves a core
+	int deadline; //absolute time it should be finished by,
+		      //INT_MAX for no deadline
 } job_t;
 
-scheme_t active_scheme;
-
 typedef struct _core_t
 {
 	int core_id;
@@ -41,79 +49,982 @@ typedef struct _core_t
 	job_t* active_job; //a pointer to the job currently running
 } core_t;
 
-//Array of cores
-core_t ** core_array;
-int m_num_cores; //number of cores
+//Idle-core bitmap: bit (x % 64) of idle_cores[x / 64] is set when core x
+//is idle, and bit w of idle_summary[w / 64] is set when idle_cores[w] has
+//any bit set, so the lowest idle core is two find-first-set operations away
+//for up to 4096 cores
+#define IDLE_WORD_BITS 64
 
-//priority queue
-priqueue_t* queue;
+/**
+  A block of job_t storage. Jobs are carved out of slabs in order and are
+  only released all at once in scheduler_destroy().
+*/
+typedef struct _job_slab_t
+{
+	struct _job_slab_t * next; //previously filled slab
+	int m_size; //number of jobs this slab holds
+	int m_num_used; //number of jobs handed out so far
+	job_t jobs[];
+} job_slab_t;
 
-//priority queue for the completed jobs
-//note that the priority of these is entirely irrelevant, but this is
-//convenient
-priqueue_t* completed_queue;
+/**
+  Running statistics of one latency over every finished job, so nothing has
+  to be kept per job once it completes.
 
+  The histogram is log-bucketed in fixed memory: values below
+  HISTOGRAM_EXACT get a bucket each, and every power of two above that is
+  split into HISTOGRAM_EXACT / 2 equal buckets (about 3% relative error).
+*/
+#define HISTOGRAM_EXACT 64
+#define HISTOGRAM_BUCKETS (HISTOGRAM_EXACT + 25 * (HISTOGRAM_EXACT / 2))
 
-//the general function pointer
-int (*compare_func)(const void *, const void *);
+typedef struct _latency_histogram_t
+{
+	long long count;
+	long long sum;
+	int min;
+	int max;
+	long long buckets[HISTOGRAM_BUCKETS];
+} latency_histogram_t;
+
+/*
+  The orderings of the heap-ordered schemes, on job_t directly. The
+  compare_* comparers at the end of the file wrap these for priqueue_t.
+ */
+static inline int job_compare_SJF(const job_t *job_a, const job_t *job_b)
+{
+	//checks time to completion, how much time is left to finish
+	//lower time left = higher priority
+	int a_remainder = job_a->length - job_a->time_running;
+	int b_remainder = job_b->length - job_b->time_running;
+
+	if(a_remainder == b_remainder)
+	{
+		//If a arrived sooner, then it will be propagated up the queue
+		//(this checks based off of the arrival times)
+		return(job_a->arrival_time - job_b->arrival_time);
+	}
+	else
+	{
+		//if a has less time left, returns a negative value and will
+		//propogate job_a further up the queue.
+		return(a_remainder - b_remainder);
+	}
+}
+
+static inline int job_compare_PRI(const job_t *job_a, const job_t *job_b)
+{
+	//Checks priority value. Lower number = higher priority
+	//tiebreak with arrival time.
+	int return_value = job_a->priority - job_b->priority;
+	if(return_value == 0)
+	{ //both priorities are identical
+		//check priority based off of arrival time
+		return_value = job_a->arrival_time - job_b->arrival_time;
+		//both arrival times shouldn't be identical, as said by the
+		//documentation
+		return(return_value);
+	}
+	else
+	{
+		//recall smaller values go to front of priority queue
+		//If a is less than b, this returns a negative value,
+		//signaling that a should propagate further up the queue
+		return(return_value);
+	}
+}
+
+static inline int job_compare_CFS(const job_t *job_a, const job_t *job_b)
+{
+	//lowest vruntime first; equal ones stay in the order they were queued
+	return((job_a->vruntime > job_b->vruntime) - (job_a->vruntime < job_b->vruntime));
+}
+
+static inline int job_compare_EDF(const job_t *job_a, const job_t *job_b)
+{
+	//earliest absolute deadline first, tiebreak with arrival time
+	if(job_a->deadline != job_b->deadline)
+	{
+		return((job_a->deadline > job_b->deadline) - (job_a->deadline < job_b->deadline));
+	}
+	return(job_a->arrival_time - job_b->arrival_time);
+}
+
+//the same orderings as sort keys: a primary key and an arrival time tiebreak
+//packed (sign bits flipped) so that they order as one unsigned integer.
+//None of them change while a job waits: its time_running and vruntime are
+//only brought up to date when it leaves a core
+static inline unsigned long long job_key_pack(int primary, int tiebreak)
+{
+	return(((unsigned long long)((unsigned int)primary ^ 0x80000000U) << 32)
+		| ((unsigned int)tiebreak ^ 0x80000000U));
+}
+
+static inline unsigned long long job_key_SJF(const job_t *job)
+{
+	return(job_key_pack(job->length - job->time_running, job->arrival_time));
+}
+
+static inline unsigned long long job_key_PRI(const job_t *job)
+{
+	return(job_key_pack(job->priority, job->arrival_time));
+}
+
+static inline unsigned long long job_key_CFS(const job_t *job)
+{
+	//vruntime alone, equal ones go in the order they were queued
+	return((unsigned long long)job->vruntime ^ (1ULL << 63));
+}
+
+static inline unsigned long long job_key_EDF(const job_t *job)
+{
+	return(job_key_pack(job->deadline, job->arrival_time));
+}
+
+//one ready queue type per ordering. Each entry keeps its job's key, so
+//sifting compares integers in the queue's array instead of reading jobs
+//(see PRIQUEUE_DEFINE_KEYED)
+PRIQUEUE_DEFINE_KEYED(sjf_queue, job_t, job_key_SJF)
+PRIQUEUE_DEFINE_KEYED(pri_queue, job_t, job_key_PRI)
+PRIQUEUE_DEFINE_KEYED(cfs_queue, job_t, job_key_CFS)
+PRIQUEUE_DEFINE_KEYED(edf_queue, job_t, job_key_EDF)
+
+/**
+  Everything one scheduler instance works on. Nothing is shared between
+  instances, so separate schedulers can run side by side (one per thread).
+*/
+struct _scheduler_t
+{
+	scheme_t active_scheme;
+
+	//the general function pointer
+	int (*compare_func)(const void *, const void *);
+
+	//Array of cores, stored contiguously
+	core_t * core_array;
+	int m_num_cores; //number of cores
+
+	//idle-core bitmap, see IDLE_WORD_BITS
+	unsigned long long * idle_cores;
+	unsigned long long * idle_summary;
+	int m_num_idle_words;
+
+	//slab new jobs are currently taken from
+	job_slab_t* job_slabs;
+	//how many jobs the next slab should hold
+	int job_slab_size;
+
+	//priority queue: FCFS and RR only (NULL otherwise), whose jobs line
+	//up in the order they are offered
+	priqueue_t* queue;
+
+	//the other schemes except MLFQ: a heap keyed by the scheme's ordering,
+	//so queueing a job makes no call through compare_func
+	union
+	{
+		sjf_queue_t sjf; //SJF and PSJF
+		pri_queue_t pri; //PRI and PPRI
+		cfs_queue_t cfs;
+		edf_queue_t edf; //EDF and PEDF
+	} ready;
+
+
+	//PSJF and PPRI only (NULL otherwise): the jobs currently on a core, with
+	//the job a new arrival would preempt at the head. Keyed so that it never
+	//needs re-keying while jobs run, see compare_running_SJF()
+	priqueue_t* running_queue;
+
+	//one histogram per latency_t
+	latency_histogram_t latency_histograms[4];
+
+	//number of jobs that finished after their deadline
+	int deadline_misses;
+
+	//scheduler_new_jobs_batch() scratch: the jobs a batch leaves waiting
+	job_t** batch_waiting;
+	int batch_waiting_size;
+
+	//MLFQ only (used instead of queue): one FIFO per level, level 0 first,
+	//with bit x of mlfq_nonempty set while level x has waiting jobs. Level x
+	//gets a quantum of mlfq_quantum << x, and every mlfq_boost_period time
+	//units (0 for never) all jobs go back to level 0
+	priqueue_t* mlfq_queues;
+	unsigned long long mlfq_nonempty;
+	int mlfq_levels;
+	int mlfq_quantum;
+	int mlfq_boost_period;
+	int mlfq_next_boost;
+
+	//CFS only: total weight of the unfinished jobs, the vruntime new jobs
+	//start at (never decreasing), and how slices are sized: a job gets
+	//its weight's share of cfs_latency, but at least cfs_granularity
+	long long cfs_total_weight;
+	long long cfs_min_vruntime;
+	int cfs_granularity;
+	int cfs_latency;
+};
+
+//CFS weight of each nice level -20..19, the same table Linux uses: every
+//step is about 25% more or less of the cores. A job's nice is its priority
+static const int cfs_prio_to_weight[40] =
+{
+	88761, 71755, 56483, 46273, 36291,
+	29154, 23254, 18705, 14949, 11916,
+	9548, 7620, 6100, 4904, 3906,
+	3121, 2501, 1991, 1586, 1277,
+	1024, 820, 655, 526, 423,
+	335, 272, 215, 172, 137,
+	110, 87, 70, 56, 45,
+	36, 29, 23, 18, 15,
+};
+#define CFS_NICE_0_WEIGHT 1024
+
+//the instance behind the original scheduler_* functions
+static scheduler_t* default_scheduler = NULL;
 
 //more specialized function declarations, definitions at end of file
 int compare_FCFS(const void *a, const void *b);
 int compare_SJF(const void *a, const void *b);
 int compare_PRI(const void *a, const void *b);
 int compare_RR(const void *a, const void *b);
+int compare_CFS(const void *a, const void *b);
+int compare_EDF(const void *a, const void *b);
+int compare_running_SJF(const void *a, const void *b);
+int compare_running_PRI(const void *a, const void *b);
+int compare_running_EDF(const void *a, const void *b);
+
+static void core_set_idle(scheduler_t *s, int core_id)
+{
+	int word = core_id / IDLE_WORD_BITS;
+	s->idle_cores[word] |= 1ULL << (core_id % IDLE_WORD_BITS);
+	s->idle_summary[word / IDLE_WORD_BITS] |= 1ULL << (word % IDLE_WORD_BITS);
+}
+
+static void core_set_busy(scheduler_t *s, int core_id)
+{
+	int word = core_id / IDLE_WORD_BITS;
+	s->idle_cores[word] &= ~(1ULL << (core_id % IDLE_WORD_BITS));
+	if(0 == s->idle_cores[word])
+	{
+		s->idle_summary[word / IDLE_WORD_BITS] &= ~(1ULL << (word % IDLE_WORD_BITS));
+	}
+}
+
+//returns the lowest numbered idle core, or -1 if every core is busy
+static int lowest_idle_core(scheduler_t *s)
+{
+	int summary_words = (s->m_num_idle_words + IDLE_WORD_BITS - 1) / IDLE_WORD_BITS;
+	for(int x = 0; x < summary_words; x++)
+	{
+		if(0 != s->idle_summary[x])
+		{
+			int word = x * IDLE_WORD_BITS + __builtin_ctzll(s->idle_summary[x]);
+			return(word * IDLE_WORD_BITS + __builtin_ctzll(s->idle_cores[word]));
+		}
+	}
+	return(-1);
+}
+
+
+//CFS: give a job starting a slice on its core its weight's share of the
+//latency target, but not below the granularity. Worked out when it starts,
+//so a job put on a core partway through a batch of arrivals is not charged
+//for the weight of the ones after it
+static void cfs_start_slice(scheduler_t *s, job_t* job)
+{
+	long long slice = (long long)s->cfs_latency * job->weight / s->cfs_total_weight;
+	job->cfs_slice = slice < s->cfs_granularity ? s->cfs_granularity : (int)slice;
+}
+
+//track a job that was just put on a core, when preemption needs to know
+static void running_add(scheduler_t *s, job_t* job)
+{
+	if(NULL != s->running_queue)
+	{
+		job->running_handle = priqueue_offer(s->running_queue, job);
+	}
+	if(CFS == s->active_scheme)
+	{
+		cfs_start_slice(s, job);
+	}
+}
+
+//stop tracking a job that is about to leave its core
+static void running_remove(scheduler_t *s, job_t* job)
+{
+	if(NULL != s->running_queue)
+	{
+		priqueue_remove_handle(s->running_queue, job->running_handle);
+	}
+}
+
+
+//put a job that is not running in line to be scheduled
+static void ready_offer(scheduler_t *s, job_t* job)
+{
+	switch(s->active_scheme)
+	{
+		case SJF: case PSJF:
+			sjf_queue_offer(&s->ready.sjf, job);
+			break;
+		case PRI: case PPRI:
+			pri_queue_offer(&s->ready.pri, job);
+			break;
+		case CFS:
+			cfs_queue_offer(&s->ready.cfs, job);
+			break;
+		case EDF: case PEDF:
+			edf_queue_offer(&s->ready.edf, job);
+			break;
+		case MLFQ:
+			priqueue_offer(&s->mlfq_queues[job->level], job);
+			s->mlfq_nonempty |= 1ULL << job->level;
+			break;
+		default:
+			priqueue_offer(s->queue, job);
+			break;
+	}
+}
+
+//ready_offer() for count jobs at once, in order
+static void ready_offer_many(scheduler_t *s, job_t** jobs, int count)
+{
+	switch(s->active_scheme)
+	{
+		case SJF: case PSJF:
+			sjf_queue_offer_many(&s->ready.sjf, jobs, count);
+			break;
+		case PRI: case PPRI:
+			pri_queue_offer_many(&s->ready.pri, jobs, count);
+			break;
+		case CFS:
+			cfs_queue_offer_many(&s->ready.cfs, jobs, count);
+			break;
+		case EDF: case PEDF:
+			edf_queue_offer_many(&s->ready.edf, jobs, count);
+			break;
+		case MLFQ:
+			//each run of jobs on the same level goes in together
+			for(int x = 0; x < count; )
+			{
+				int level = jobs[x]->level;
+				int run = 1;
+				while(x + run < count && level == jobs[x + run]->level)
+				{
+					run++;
+				}
+				priqueue_offer_many(&s->mlfq_queues[level], (void **)&jobs[x], run);
+				s->mlfq_nonempty |= 1ULL << level;
+				x = x + run;
+			}
+			break;
+		default:
+			priqueue_offer_many(s->queue, (void **)jobs, count);
+			break;
+	}
+}
+
+//take the next job to schedule out of line, NULL if none are waiting
+static job_t* ready_poll(scheduler_t *s)
+{
+	switch(s->active_scheme)
+	{
+		case SJF: case PSJF:
+			return(sjf_queue_poll(&s->ready.sjf));
+		case PRI: case PPRI:
+			return(pri_queue_poll(&s->ready.pri));
+		case EDF: case PEDF:
+			return(edf_queue_poll(&s->ready.edf));
+		case CFS:
+		{
+			job_t* job = cfs_queue_poll(&s->ready.cfs);
+			if(NULL != job && job->vruntime > s->cfs_min_vruntime)
+			{
+				s->cfs_min_vruntime = job->vruntime;
+			}
+			return(job);
+		}
+		case MLFQ:
+		{
+			if(0 == s->mlfq_nonempty)
+			{
+				return(NULL);
+			}
+			//the highest non-empty level is the lowest set bit
+			int level = __builtin_ctzll(s->mlfq_nonempty);
+			job_t* job = priqueue_poll(&s->mlfq_queues[level]);
+			if(0 == priqueue_size(&s->mlfq_queues[level]))
+			{
+				s->mlfq_nonempty &= ~(1ULL << level);
+			}
+			return(job);
+		}
+		default:
+			return(priqueue_poll(s->queue));
+	}
+}
+
+static int ready_empty(scheduler_t *s)
+{
+	switch(s->active_scheme)
+	{
+		case SJF: case PSJF:
+			return(0 == sjf_queue_size(&s->ready.sjf));
+		case PRI: case PPRI:
+			return(0 == pri_queue_size(&s->ready.pri));
+		case CFS:
+			return(0 == cfs_queue_size(&s->ready.cfs));
+		case EDF: case PEDF:
+			return(0 == edf_queue_size(&s->ready.edf));
+		case MLFQ:
+			return(0 == s->mlfq_nonempty);
+		default:
+			return(0 == priqueue_size(s->queue));
+	}
+}
+
+//MLFQ: if a boost came due since the last call, move every job back to
+//level 0. Jobs only change cores when the scheduler is called, so doing it
+//lazily here gives the same schedule as boosting on time
+static void mlfq_boost(scheduler_t *s, int time)
+{
+	if(0 == s->mlfq_boost_period || time < s->mlfq_next_boost)
+	{
+		return;
+	}
+	s->mlfq_next_boost = (time / s->mlfq_boost_period + 1) * s->mlfq_boost_period;
+
+	//waiting jobs keep their order, higher levels first
+	for(int level = 1; level < s->mlfq_levels; level++)
+	{
+		job_t* job;
+		while(NULL != (job = priqueue_poll(&s->mlfq_queues[level])))
+		{
+			job->level = 0;
+			priqueue_offer(&s->mlfq_queues[0], job);
+		}
+	}
+	s->mlfq_nonempty = (0 == priqueue_size(&s->mlfq_queues[0])) ? 0 : 1;
+
+	for(int x = 0; x < s->m_num_cores; x++)
+	{
+		if(NULL != s->core_array[x].active_job)
+		{
+			s->core_array[x].active_job->level = 0;
+		}
+	}
+}
+
+
+//CFS: vruntime a job earns by running ran time units
+static long long cfs_vruntime_delta(job_t* job, int ran)
+{
+	return((long long)ran * CFS_NICE_0_WEIGHT * CFS_NICE_0_WEIGHT / job->weight);
+}
+
+//CFS: the vruntime a new job starts at, the smallest of the running jobs'
+//(as of time) and the next queued job's, so it neither jumps the line
+//nor starts behind everyone. Never decreases
+static long long cfs_start_vruntime(scheduler_t *s, int time)
+{
+	long long lowest = -1;
+	job_t* next_job = cfs_queue_peek(&s->ready.cfs);
+	if(NULL != next_job)
+	{
+		lowest = next_job->vruntime;
+	}
+	for(int x = 0; x < s->m_num_cores; x++)
+	{
+		job_t* job = s->core_array[x].active_job;
+		if(NULL != job)
+		{
+			long long vruntime = job->vruntime
+				+ cfs_vruntime_delta(job, time - job->time_last_scheduled);
+			if(-1 == lowest || vruntime < lowest)
+			{
+				lowest = vruntime;
+			}
+		}
+	}
+	if(lowest > s->cfs_min_vruntime)
+	{
+		s->cfs_min_vruntime = lowest;
+	}
+	return(s->cfs_min_vruntime);
+}
+
+
+//histogram bucket for value (negative values count as 0)
+static int histogram_bucket(int value)
+{
+	if(value < HISTOGRAM_EXACT)
+	{
+		return(value < 0 ? 0 : value);
+	}
+	//value is in [32 << group, 64 << group)
+	int group = (31 - __builtin_clz(value)) - 5;
+	return(HISTOGRAM_EXACT + (group - 1) * (HISTOGRAM_EXACT / 2)
+		+ ((value >> group) - HISTOGRAM_EXACT / 2));
+}
+
+//largest value that lands in bucket
+static int histogram_bucket_top(int bucket)
+{
+	if(bucket < HISTOGRAM_EXACT)
+	{
+		return(bucket);
+	}
+	int group = (bucket - HISTOGRAM_EXACT) / (HISTOGRAM_EXACT / 2) + 1;
+	long long mantissa = (bucket - HISTOGRAM_EXACT) % (HISTOGRAM_EXACT / 2) + HISTOGRAM_EXACT / 2;
+	return((int)(((mantissa + 1) << group) - 1));
+}
+
+static void histogram_add(latency_histogram_t* histogram, int value)
+{
+	if(0 == histogram->count || value < histogram->min)
+	{
+		histogram->min = value;
+	}
+	if(0 == histogram->count || value > histogram->max)
+	{
+		histogram->max = value;
+	}
+	histogram->count++;
+	histogram->sum += value;
+	histogram->buckets[histogram_bucket(value)]++;
+}
+
+//smallest bucketed value that at least fraction of the values are <= to
+static int histogram_percentile(latency_histogram_t* histogram, double fraction)
+{
+	long long rank = (long long)(fraction * histogram->count);
+	if(rank < fraction * histogram->count)
+	{
+		rank++; //round up
+	}
+	if(rank < 1)
+	{
+		rank = 1;
+	}
+
+	long long seen = 0;
+	for(int x = 0; x < HISTOGRAM_BUCKETS; x++)
+	{
+		seen += histogram->buckets[x];
+		if(seen >= rank)
+		{
+			int value = histogram_bucket_top(x);
+			//the bucket may reach past the values actually seen
+			if(value > histogram->max)
+			{
+				value = histogram->max;
+			}
+			if(value < histogram->min)
+			{
+				value = histogram->min;
+			}
+			return(value);
+		}
+	}
+	return(histogram->max);
+}
+
 
 /**
-  Initalizes the scheduler.
+  Takes a job_t out of the current slab, starting a new (larger) slab when
+  the current one is full.
+ */
+static job_t* job_alloc(scheduler_t *s)
+{
+	if(NULL == s->job_slabs || s->job_slabs->m_num_used == s->job_slabs->m_size)
+	{
+		job_slab_t* new_slab = malloc(sizeof(job_slab_t) + s->job_slab_size * sizeof(job_t));
+		new_slab->next = s->job_slabs;
+		new_slab->m_size = s->job_slab_size;
+		new_slab->m_num_used = 0;
+		s->job_slabs = new_slab;
+		s->job_slab_size = 2 * s->job_slab_size; //grow geometrically
+	}
+	return(&s->job_slabs->jobs[s->job_slabs->m_num_used++]);
+}
+
+
+//work every arrival at time shares, done once per call whatever the number
+//of jobs. Admitting a job leaves the CFS start vruntime where it was (the
+//job starts at it), so it holds for a whole batch
+static void arrivals_begin(scheduler_t *s, int time)
+{
+	if(MLFQ == s->active_scheme)
+	{
+		mlfq_boost(s, time);
+	}
+	else if(CFS == s->active_scheme)
+	{
+		cfs_start_vruntime(s, time);
+	}
+}
+
+//a new job, arriving at time and not yet on a core or in line
+static job_t* job_create(scheduler_t *s, int job_number, int time, int running_time, int priority, int deadline)
+{
+	job_t* new_job = job_alloc(s);
+	new_job->job_id = job_number;
+	new_job->arrival_time = time;
+	new_job->length = running_time;
+	new_job->priority = priority;
+	new_job->time_running = 0; //fresh off the presses
+	new_job->time_last_scheduled = -1;
+	new_job->time_first_scheduled = -1;
+	new_job->level = 0; //MLFQ: new jobs start at the top
+	if(NO_DEADLINE == deadline || (long long)time + deadline >= INT_MAX)
+	{
+		new_job->deadline = INT_MAX;
+	}
+	else
+	{
+		new_job->deadline = time + deadline;
+	}
+	if(CFS == s->active_scheme)
+	{
+		int nice = priority < -20 ? -20 : (priority > 19 ? 19 : priority);
+		new_job->weight = cfs_prio_to_weight[nice + 20];
+		new_job->vruntime = s->cfs_min_vruntime;
+		s->cfs_total_weight += new_job->weight;
+	}
+	return(new_job);
+}
+
+/**
+  Puts a new job on the lowest idle core, or on the core of the running job
+  it preempts. Returns that core, or -1 if it has to wait. *waiting is set
+  to the job that now has to go in line (the new job itself, or the one it
+  preempted), NULL if none; the caller queues it.
+ */
+static int job_admit(scheduler_t *s, job_t* new_job, int time, job_t** waiting)
+{
+	*waiting = NULL;
+
+	int x = lowest_idle_core(s);
+	if( -1 != x)
+	{ //if a core is unoccupied, fill the lowest numbered one
+		s->core_array[x].active_job_id = new_job->job_id;
+		s->core_array[x].active_job = new_job;
+		core_set_busy(s, x);
+		new_job->core_id = x;
+		new_job->time_last_scheduled = time;
+		new_job->time_first_scheduled = time;
+		running_add(s, new_job);
+
+		return(x);
+	}
+	//at this point we know no core is free
+	//check for preemption, if applicable
+	if(PPRI == s->active_scheme || PSJF == s->active_scheme || PEDF == s->active_scheme)
+	{ //a preemptive scheme
+		//running_queue's head is the job with the lowest priority; that
+		//is, the job we're checking to see if we should swap it out. Ties
+		//go to the lowest numbered core
+		job_t* curr_job = priqueue_peek(s->running_queue);
+		int lowest_priority_location = curr_job->core_id;
+
+		//For proper comparisons, the candidate's running time must be
+		//brought up to date (this is for the PSJF scheme). Other running
+		//jobs catch up when they next leave their core
+		curr_job->time_running = curr_job->time_running + (time
+				- curr_job->time_last_scheduled);
+		curr_job->time_last_scheduled = time;
+
+		if(0 > s->compare_func(new_job , curr_job))
+		{//the new job preempts the current one
+			//remove old job from the core, it goes in line
+			running_remove(s, curr_job);
+			curr_job->core_id = -1;
+			*waiting = curr_job;
+			if(curr_job->time_first_scheduled == time)
+			{
+				//this job got scheduled, and then
+				//immediately kicked off the core,
+				//so reset first schedule time
+				curr_job->time_first_scheduled = -1;
+			}
+			//put new job onto core, update its values accordingly
+			s->core_array[lowest_priority_location].active_job = new_job;
+			new_job->core_id = lowest_priority_location;
+			new_job->time_last_scheduled = time;
+			new_job->time_first_scheduled = time;
+			s->core_array[lowest_priority_location].active_job_id = new_job->job_id;
+			core_set_busy(s, lowest_priority_location);
+			running_add(s, new_job);
+			return(lowest_priority_location); //return core it's running on
+		}
+	}
+	//nothing it can or will preempt, it goes in line
+	*waiting = new_job;
+	return(-1);
+}
+
+
+/**
+  Creates a scheduler. Every other scheduler_*_r function takes the handle
+  returned here, and schedulers created separately share no state.
  
   Assumptions:
-    - You may assume this will be the first scheduler function called.
-    - You may assume this function will be called once once.
     - You may assume that cores is a positive, non-zero number.
     - You may assume that scheme is a valid scheduling scheme.
 
   @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
-  @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
+  @param scheme  the scheduling scheme that should be used. This value will be one of the enum values of scheme_t
+  @return the new scheduler, to be released with scheduler_destroy()
 */
-void scheduler_start_up(int cores, scheme_t scheme)
+scheduler_t* scheduler_create(int cores, scheme_t scheme)
 {
-	active_scheme = scheme;
+	scheduler_t* s = malloc(sizeof(scheduler_t));
+	s->active_scheme = scheme;
 
 	//use the scheme value to decide which comparison function
 	//to use for the rest of the program	
-	if(active_scheme == FCFS)
+	if(s->active_scheme == FCFS)
 	{
-		compare_func = &compare_FCFS;
+		s->compare_func = &compare_FCFS;
 	}
-	else if(active_scheme == SJF || active_scheme == PSJF)
+	else if(s->active_scheme == SJF || s->active_scheme == PSJF)
 	{
-		compare_func = &compare_SJF;
+		s->compare_func = &compare_SJF;
 	}
-	else if(active_scheme == PRI || active_scheme == PPRI)
+	else if(s->active_scheme == PRI || s->active_scheme == PPRI)
 	{
-		compare_func = &compare_PRI;
+		s->compare_func = &compare_PRI;
+	}
+	else if(s->active_scheme == CFS)
+	{
+		s->compare_func = &compare_CFS;
+	}
+	else if(s->active_scheme == EDF || s->active_scheme == PEDF)
+	{
+		s->compare_func = &compare_EDF;
 	}
 	else
 	{
-		compare_func = &compare_RR;
+		//RR, and each level of MLFQ
+		s->compare_func = &compare_RR;
+	}
+	s->m_num_cores = cores;
+	s->core_array = malloc(cores * sizeof(core_t) ); //initializes the array of cores
+	for(int x=0; x < cores; x++)
+	{
+		s->core_array[x].core_id = x;
+		s->core_array[x].active_job_id = -1;
+		s->core_array[x].active_job = NULL;
 	}
-	m_num_cores = cores;
-	core_array = malloc(cores * sizeof(core_t*) ); //initializes the array of cores
+
+	s->m_num_idle_words = (cores + IDLE_WORD_BITS - 1) / IDLE_WORD_BITS;
+	s->idle_cores = calloc(s->m_num_idle_words, sizeof(*s->idle_cores));
+	s->idle_summary = calloc((s->m_num_idle_words + IDLE_WORD_BITS - 1) / IDLE_WORD_BITS, sizeof(*s->idle_summary));
 	for(int x=0; x < cores; x++)
 	{
-		core_t* new_core = malloc(sizeof(core_t));
-		new_core->core_id = x;
-		new_core->active_job_id = -1;
-		new_core->active_job = NULL;
-		core_array[x] = new_core;
+		core_set_idle(s, x); //every core starts idle
+	}
+
+	s->job_slabs = NULL;
+	s->job_slab_size = 64;
+
+	memset(s->latency_histograms, 0, sizeof(s->latency_histograms));
+	s->deadline_misses = 0;
+	s->batch_waiting = NULL;
+	s->batch_waiting_size = 0;
+
+	s->queue = NULL;
+	s->running_queue = NULL;
+	s->mlfq_queues = NULL;
+	s->mlfq_levels = 0;
+	if(s->active_scheme == MLFQ)
+	{
+		scheduler_mlfq_configure_r(s, MLFQ_DEFAULT_LEVELS, 1, MLFQ_DEFAULT_BOOST);
+	}
+	s->cfs_total_weight = 0;
+	s->cfs_min_vruntime = 0;
+	s->cfs_granularity = CFS_DEFAULT_GRANULARITY;
+	s->cfs_latency = CFS_DEFAULT_LATENCY;
+	if(s->active_scheme == PSJF || s->active_scheme == PPRI || s->active_scheme == PEDF)
+	{
+		s->running_queue = malloc(sizeof(priqueue_t));
+		if(s->active_scheme == PSJF)
+		{
+			priqueue_init_mode(s->running_queue, &compare_running_SJF, PRIQUEUE_HEAP);
+		}
+		else if(s->active_scheme == PPRI)
+		{
+			priqueue_init_mode(s->running_queue, &compare_running_PRI, PRIQUEUE_HEAP);
+		}
+		else
+		{
+			priqueue_init_mode(s->running_queue, &compare_running_EDF, PRIQUEUE_HEAP);
+		}
+	}
+	if(s->active_scheme == FCFS || s->active_scheme == RR)
+	{
+		//FCFS jobs are never requeued and are offered in arrival order,
+		//and compare_RR ties everything, so both are plain FIFOs
+		s->queue = malloc(sizeof(priqueue_t));
+		priqueue_init_mode(s->queue, s->compare_func, PRIQUEUE_FIFO);
+	}
+	//the rest get a heap: offer/poll stay O(log n) however many jobs are
+	//waiting, and ties still come out in the order they were offered. For
+	//CFS it stands in for the kernel's red-black tree: only the leftmost
+	//(lowest vruntime) job is ever taken out
+	else if(s->active_scheme == SJF || s->active_scheme == PSJF)
+	{
+		sjf_queue_init(&s->ready.sjf);
+	}
+	else if(s->active_scheme == PRI || s->active_scheme == PPRI)
+	{
+		pri_queue_init(&s->ready.pri);
+	}
+	else if(s->active_scheme == CFS)
+	{
+		cfs_queue_init(&s->ready.cfs);
+	}
+	else if(s->active_scheme == EDF || s->active_scheme == PEDF)
+	{
+		edf_queue_init(&s->ready.edf);
+	}
+
+	return(s);
+}
+
+
+/**
+  Sets up the levels of an MLFQ scheduler. scheduler_create() uses
+  MLFQ_DEFAULT_LEVELS levels, a quantum of 1 and a boost every
+  MLFQ_DEFAULT_BOOST time units.
+
+  New jobs start at level 0. A job that uses up its whole quantum moves
+  down a level, and the highest non-empty level is always served first.
+  The quantum doubles with every level down.
+
+  Assumptions:
+    - The scheme is MLFQ, and no job has arrived yet.
+    - levels is between 1 and MLFQ_MAX_LEVELS, quantum is positive.
+
+  @param levels the number of levels
+  @param quantum the quantum of level 0
+  @param boost_period move every job back to level 0 every this many time units (0 for never)
+ */
+void scheduler_mlfq_configure_r(scheduler_t *s, int levels, int quantum, int boost_period)
+{
+	for(int x = 0; x < s->mlfq_levels; x++)
+	{
+		priqueue_destroy(&s->mlfq_queues[x]);
+	}
+	free(s->mlfq_queues);
+
+	s->mlfq_levels = levels;
+	s->mlfq_quantum = quantum;
+	s->mlfq_boost_period = boost_period;
+	s->mlfq_next_boost = boost_period;
+	s->mlfq_nonempty = 0;
+	s->mlfq_queues = malloc(levels * sizeof(priqueue_t));
+	for(int x = 0; x < levels; x++)
+	{
+		priqueue_init_mode(&s->mlfq_queues[x], s->compare_func, PRIQUEUE_FIFO);
+	}
+}
+
+
+/**
+  Sets how CFS sizes time slices. A job on a core gets latency times its
+  share of the total weight of the unfinished jobs, but never less than
+  granularity; scheduler_quantum_expired() is called when it runs out.
+  scheduler_create() uses CFS_DEFAULT_GRANULARITY and CFS_DEFAULT_LATENCY.
+
+  Assumptions:
+    - The scheme is CFS.
+    - granularity is positive.
+
+  @param granularity the shortest slice a job gets
+  @param latency the time in which every unfinished job should get to run once, if possible
+ */
+void scheduler_cfs_configure_r(scheduler_t *s, int granularity, int latency)
+{
+	s->cfs_granularity = granularity;
+	s->cfs_latency = latency;
+}
+
+
+/**
+  Returns the quantum the job now running on core_id should get, for
+  schemes where it depends on the job (MLFQ and CFS). The simulator asks
+  after every call that may have put a new job on the core. A CFS slice is
+  worked out from the weight of the jobs admitted when the job was put on
+  the core.
+
+  @param core_id the zero-based index of the core
+  @return the quantum, in time units
+  @return -1 if the core is idle or the scheme has no per-job quantum
+ */
+int scheduler_core_quantum_r(scheduler_t *s, int core_id)
+{
+	job_t* job = s->core_array[core_id].active_job;
+	if(NULL == job)
+	{
+		return(-1);
+	}
+	if(CFS == s->active_scheme)
+	{
+		return(job->cfs_slice);
+	}
+	if(MLFQ != s->active_scheme)
+	{
+		return(-1);
 	}
+	//the quantum doubles per level, but stays well within an int
+	long long quantum = (long long)s->mlfq_quantum << (job->level < 30 ? job->level : 30);
+	return(quantum > (1 << 30) ? (1 << 30) : (int)quantum);
+}
+
+
+/**
+  Tells the scheduler how many jobs to expect, so job storage and the ready
+  queue can be allocated up front in one block each instead of growing as
+  jobs arrive (or as a large backlog is seeded with
+  scheduler_new_jobs_batch_r()).
 
-	queue = malloc(sizeof(priqueue_t));
-	completed_queue = malloc(sizeof(priqueue_t));
-	priqueue_init(completed_queue, &compare_FCFS);//FCFS to sort by arrival time
-						      //in the completed queue
-	priqueue_init(queue, compare_func);
+  Assumptions:
+    - This is optional and only a hint; more jobs than job_count may arrive.
+    - Call it after scheduler_start_up() and before the first job arrives.
+
+  @param job_count the number of jobs expected over the whole run.
+ */
+void scheduler_reserve_jobs_r(scheduler_t *s, int job_count)
+{
+	if(NULL == s->job_slabs && job_count > s->job_slab_size)
+	{
+		s->job_slab_size = job_count;
+	}
 
+	//every job could be waiting at once, so that is the most the ready
+	//queue will ever hold (new jobs start at the top MLFQ level)
+	switch(s->active_scheme)
+	{
+		case SJF: case PSJF:
+			sjf_queue_reserve(&s->ready.sjf, job_count);
+			break;
+		case PRI: case PPRI:
+			pri_queue_reserve(&s->ready.pri, job_count);
+			break;
+		case CFS:
+			cfs_queue_reserve(&s->ready.cfs, job_count);
+			break;
+		case EDF: case PEDF:
+			edf_queue_reserve(&s->ready.edf, job_count);
+			break;
+		case MLFQ:
+			priqueue_reserve(&s->mlfq_queues[0], job_count);
+			break;
+		default:
+			priqueue_reserve(s->queue, job_count);
+			break;
+	}
 }
 
 
@@ -137,98 +1048,93 @@ void scheduler_start_up(int cores, scheme_t scheme)
   @return -1 if no scheduling changes should be made. 
  
  */
-int scheduler_new_job(int job_number, int time, int running_time, int priority)
+int scheduler_new_job_r(scheduler_t *s, int job_number, int time, int running_time, int priority)
 {
-	//First: create a new job
-	job_t* new_job = malloc(sizeof(job_t));
-	new_job->job_id = job_number;
-	new_job->arrival_time = time;
-	new_job->length = running_time;
-	new_job->priority = priority;
-	new_job->time_running = 0; //fresh off the presses
-	new_job->time_last_scheduled = -1;
-	new_job->time_first_scheduled = -1;
-	//Second: check for an empty core
+	return(scheduler_new_job_deadline_r(s, job_number, time, running_time, priority, NO_DEADLINE));
+}
+
 
+/**
+  Same as scheduler_new_job(), for a job that should finish within deadline
+  time units of arriving. EDF and PEDF run the job with the earliest
+  deadline first (jobs without one go last, in arrival order); every scheme
+  counts the jobs that miss theirs, see scheduler_deadline_misses().
+
+  @param deadline time units after time the job should be finished by, or NO_DEADLINE
+  @return the same as scheduler_new_job()
+ */
+int scheduler_new_job_deadline_r(scheduler_t *s, int job_number, int time, int running_time, int priority, int deadline)
+{
+	arrivals_begin(s, time);
+	job_t* new_job = job_create(s, job_number, time, running_time, priority, deadline);
 
-	int x = 0;
-	for( x = 0; x < m_num_cores; x++)
+	job_t* waiting;
+	int core_id = job_admit(s, new_job, time, &waiting);
+	if(NULL != waiting)
 	{
-		if( -1 == core_array[x]->active_job_id)
-		{ //if the core is unoccupied, fill it
-			core_array[x]->active_job_id = job_number;
-			core_array[x]->active_job = new_job;
-			new_job->core_id = x;
-			new_job->time_last_scheduled = time;
-			new_job->time_first_scheduled = time;
+		ready_offer(s, waiting);
+	}
+	return(core_id);
+}
 
-			return(x);
-		}
+
+/**
+  Admits every job arriving at time at once, with the same outcome as
+  calling scheduler_new_job_deadline() for each of them in order. Only the
+  first job pays for MLFQ boosting and the CFS start vruntime, and the jobs
+  left waiting go into the ready queue in one priqueue_offer_many(). A CFS
+  job put on a core gets its slice against the weight admitted up to and
+  including it, as it would have from its own call.
+
+  Each arrival's core_id and preempted_job are filled in with what its
+  scheduler_new_job_deadline() call would have done: the core it was put on
+  (-1 if it waits) and the job it took that core from (-1 if the core was
+  idle). A job may be preempted by a later one of the same batch, so apply
+  them in order.
+
+  @param arrivals the jobs, in the order they should be admitted
+  @param count the number of jobs in arrivals
+  @param time the current time of the simulator.
+  @return the number of arrivals that were put on a core
+ */
+int scheduler_new_jobs_batch_r(scheduler_t *s, job_arrival_t *arrivals, int count, int time)
+{
+	if(count > s->batch_waiting_size)
+	{
+		free(s->batch_waiting);
+		s->batch_waiting = malloc(count * sizeof(*s->batch_waiting));
+		s->batch_waiting_size = count;
 	}
-	//at this point we know no core is free
-	//check for preemption, if applicable
-	if(PPRI == active_scheme || PSJF == active_scheme)
-	{ //a preemptive scheme
-		//For proper comparisons, the currently running job must be
-		//updated (for running time) (this is for the PJSF scheme
-		for(x = 0; x < m_num_cores; x++)
-		{
-			job_t* curr_job = core_array[x]->active_job;
-			curr_job->time_running = curr_job->time_running + (time
-					- curr_job->time_last_scheduled);
-			curr_job->time_last_scheduled = time;
-		}
-		//initialize this as the first core
-		int lowest_priority_location = 0;
-		for(x = 1; x < m_num_cores; x++)
-		{//start at second core, this section will only prompt on multi core systems
-			job_t* running_job = core_array[x]->active_job;
-			job_t* lowest_priority_job = core_array[lowest_priority_location]->active_job;
-			if(0 < compare_func(running_job , lowest_priority_job ))
-			{
-				//"running_job" has less priority than
-				//"lowest_priority"
-				lowest_priority_location = x;
-			}
-		}
 
-		//create pointer "curr_job" that points to the job with the lowest priority; that is,
-		//the job we're checking to see if we should swap it out
-		job_t* curr_job = core_array[lowest_priority_location]->active_job;
+	arrivals_begin(s, time);
 
-		if(0 > compare_func(new_job , curr_job))
-		{//the new job preempts the current one
-			//remove old job from the core
-			curr_job->core_id = -1;
-			//add old job to queue
-			priqueue_offer(queue, curr_job);
-			if(curr_job->time_first_scheduled == time)
+	int placed = 0, waiting_count = 0;
+	for(int x = 0; x < count; x++)
+	{
+		job_arrival_t* arrival = &arrivals[x];
+		job_t* new_job = job_create(s, arrival->job_number, time,
+				arrival->running_time, arrival->priority, arrival->deadline);
+
+		job_t* waiting;
+		arrival->core_id = job_admit(s, new_job, time, &waiting);
+		arrival->preempted_job = -1;
+		if(-1 != arrival->core_id)
+		{
+			placed++;
+			if(NULL != waiting)
 			{
-				//this job got scheduled, and then
-				//immediately kicked off the core,
-				//so reset first schedule time
-				curr_job->time_first_scheduled = -1;
+				arrival->preempted_job = waiting->job_id;
 			}
-			//put new job onto core, update its values accordingly
-			core_array[lowest_priority_location]->active_job = new_job;
-			new_job->core_id = lowest_priority_location;
-			new_job->time_last_scheduled = time;
-			new_job->time_first_scheduled = time;
-			core_array[lowest_priority_location]->active_job_id = job_number;
-			return(lowest_priority_location); //return core it's running on
 		}
-
-		//At this point, it couldn't get scheduled, so add to queue
-		priqueue_offer(queue, new_job);
-		return(-1); //-1 means it's not been scheduled
-	}
-	else
-	{ //nothing it can or will preempt, add to job queue, return -1
-		priqueue_offer(queue, new_job);
-		return(-1);
+		if(NULL != waiting)
+		{
+			//queued in the order single calls would have queued them
+			s->batch_waiting[waiting_count++] = waiting;
+		}
 	}
-	//this shouldn't prompt, but it will silence the compile warning
-	return(-1);
+
+	ready_offer_many(s, s->batch_waiting, waiting_count);
+	return(placed);
 }
 
 
@@ -246,28 +1152,54 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
   @return job_number of the job that should be scheduled to run on core core_id
   @return -1 if core should remain idle.
  */
-int scheduler_job_finished(int core_id, int job_number, int time)
+int scheduler_job_finished_r(scheduler_t *s, int core_id, int job_number, int time)
 {
-	//update and store the completed job into the completed jobs queue
-	job_t* finished_job = core_array[core_id]->active_job;
+	if(MLFQ == s->active_scheme)
+	{
+		mlfq_boost(s, time);
+	}
+
+	//update the completed job and record its latencies
+	job_t* finished_job = s->core_array[core_id].active_job;
+	if(CFS == s->active_scheme)
+	{
+		s->cfs_total_weight -= finished_job->weight;
+	}
+	running_remove(s, finished_job);
 	finished_job->completion_time = time;
 	finished_job->core_id = -1; //not being scheduled anymore
 	finished_job->time_running = finished_job->length; //run its entire course
 	finished_job->time_last_scheduled = time;
-	priqueue_offer(completed_queue, finished_job);
+	histogram_add(&s->latency_histograms[LATENCY_WAITING], finished_job->completion_time
+				- finished_job->arrival_time - finished_job->length);
+	histogram_add(&s->latency_histograms[LATENCY_TURNAROUND], finished_job->completion_time
+				- finished_job->arrival_time);
+	histogram_add(&s->latency_histograms[LATENCY_RESPONSE], finished_job->time_first_scheduled
+				- finished_job->arrival_time);
+	if(INT_MAX != finished_job->deadline)
+	{
+		//finishing right on the deadline still makes it
+		int lateness = finished_job->completion_time - finished_job->deadline;
+		if(lateness > 0)
+		{
+			s->deadline_misses++;
+		}
+		histogram_add(&s->latency_histograms[LATENCY_LATENESS], lateness > 0 ? lateness : 0);
+	}
 
 
-	core_array[core_id]->active_job = NULL;
-	core_array[core_id]->active_job_id = -1;
+	s->core_array[core_id].active_job = NULL;
+	s->core_array[core_id].active_job_id = -1;
+	core_set_idle(s, core_id);
 	//check for what should be run next
-	if( NULL == priqueue_peek(queue) )
+	if( ready_empty(s) )
 	{ //there's nothing else to run
 		return(-1);
 	}
 	else
 	{ //there are other jobs to run
 		//remove the head of the priority queue and place in "temp"
-		job_t* temp = priqueue_poll(queue);
+		job_t* temp = ready_poll(s);
 		temp->core_id = core_id;
 		temp->time_last_scheduled = time;
 	
@@ -277,8 +1209,10 @@ int scheduler_job_finished(int core_id, int job_number, int time)
 		}
 
 		//after updating the job, place it into the core array
-		core_array[core_id]->active_job_id = temp->job_id;
-		core_array[core_id]->active_job = temp;
+		s->core_array[core_id].active_job_id = temp->job_id;
+		s->core_array[core_id].active_job = temp;
+		core_set_busy(s, core_id);
+		running_add(s, temp);
 		return(temp->job_id); //return the running job id
 	}
 
@@ -288,8 +1222,8 @@ int scheduler_job_finished(int core_id, int job_number, int time)
 
 
 /**
-  When the scheme is set to RR, called when the quantum timer has expired
-  on a core.
+  When the scheme is set to RR, MLFQ or CFS, called when the quantum timer
+  has expired on a core.
  
   If any job should be scheduled to run on the core free'd up by
   the quantum expiration, return the job_number of the job that should be
@@ -300,45 +1234,76 @@ int scheduler_job_finished(int core_id, int job_number, int time)
   @return job_number of the job that should be scheduled on core cord_id
   @return -1 if core should remain idle
  */
-int scheduler_quantum_expired(int core_id, int time)
+int scheduler_quantum_expired_r(scheduler_t *s, int core_id, int time)
 {
 	//note that this function will never be called at the same time unit
 	//that the job completes, as is said in the documentation
+
+	if(MLFQ == s->active_scheme && -1 != s->core_array[core_id].active_job_id)
+	{
+		mlfq_boost(s, time);
+
+		//it used up its quantum: move it down a level
+		job_t* expired_job = s->core_array[core_id].active_job;
+		if(expired_job->level < s->mlfq_levels - 1)
+		{
+			expired_job->level++;
+		}
+		//only switch if something waits at its new level or above
+		if(0 == (s->mlfq_nonempty & ((2ULL << expired_job->level) - 1)))
+		{
+			return(expired_job->job_id);
+		}
+	}
 	
-	if( NULL == priqueue_peek(queue) && -1 == core_array[core_id]->active_job_id )
+	if( ready_empty(s) && -1 == s->core_array[core_id].active_job_id )
 	{//queue is empty and this one is idle
 		return(-1);//remain idle
 	}
-	else if(NULL == priqueue_peek(queue) && -1 != core_array[core_id]->active_job_id)
+	else if(ready_empty(s) && -1 != s->core_array[core_id].active_job_id)
 	{
 		//queue is empty and there is an active job running
-		return(core_array[core_id]->active_job_id); //keep running this one
+		if(CFS == s->active_scheme)
+		{
+			cfs_start_slice(s, s->core_array[core_id].active_job);
+		}
+		return(s->core_array[core_id].active_job_id); //keep running this one
 	}
 
 	//implicit else
 	
-	job_t* old_job = core_array[core_id]->active_job;//get the former job
+	job_t* old_job = s->core_array[core_id].active_job;//get the former job
+	running_remove(s, old_job);
 	//reset the core variables
-	core_array[core_id]->active_job = NULL;
-	core_array[core_id]->active_job_id = -1;
+	s->core_array[core_id].active_job = NULL;
+	s->core_array[core_id].active_job_id = -1;
+	core_set_idle(s, core_id);
 
 	//update the old job
 	old_job->time_running = old_job->time_running + (time -
 				old_job->time_last_scheduled);
+	if(CFS == s->active_scheme)
+	{
+		//it goes back in line by how much it has run, so it comes
+		//straight back out if it is still the furthest behind
+		old_job->vruntime += cfs_vruntime_delta(old_job, time - old_job->time_last_scheduled);
+	}
 	
 	old_job->time_last_scheduled = time;
 
-	priqueue_offer(queue,old_job); //place back on queue
+	ready_offer(s, old_job); //place back on queue
 
-	job_t* new_job = priqueue_poll(queue); //get front of queue
+	job_t* new_job = ready_poll(s); //get front of queue
 
 	//Update core
-	core_array[core_id]->active_job = new_job;
-	core_array[core_id]->active_job_id = new_job->job_id;
+	s->core_array[core_id].active_job = new_job;
+	s->core_array[core_id].active_job_id = new_job->job_id;
+	core_set_busy(s, core_id);
 
 	//update new job
 	new_job->time_last_scheduled = time;
 	new_job->core_id = core_id;
+	running_add(s, new_job);
 
 	if( -1 == new_job->time_first_scheduled )
 	{ //job has never been scheduled before
@@ -358,33 +1323,15 @@ int scheduler_quantum_expired(int core_id, int time)
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
   @return the average waiting time of all jobs scheduled.
  */
-float scheduler_average_waiting_time()
+float scheduler_average_waiting_time_r(scheduler_t *s)
 {
 	//Average waiting time is for the time spent in the queue after being
-	//created.
-	int total_jobs = completed_queue->m_num_entries;
-
-	int total_waiting_time = 0;
-	for(int x = 0; x < total_jobs; x++)
-	{
-		job_t* temp = priqueue_at(completed_queue, x);
-		/* Error checking
-		if(temp == NULL) //A 
-		{
-			printf("Error in calculating average, ");
-			//printf("%2d: %s\n",x);
-			break;
-		}
-		*/
-		total_waiting_time = total_waiting_time + (temp->completion_time
-					- temp->arrival_time - temp->length);
-	}
-
-	//calculate the total amount of time spent in the waiting queue, then
-	//divide by the total number of jobs. 
-	//also cast those integers to floats
-	float average = (float)total_waiting_time / (float)total_jobs;
+	//created. The total is accumulated as jobs finish.
+	latency_histogram_t* waiting = &s->latency_histograms[LATENCY_WAITING];
 
+	//divide the total amount of time spent in the waiting queue by the
+	//total number of jobs, cast to floats
+	float average = (float)waiting->sum / (float)waiting->count;
 
 	return(average);
 }
@@ -397,22 +1344,13 @@ float scheduler_average_waiting_time()
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
   @return the average turnaround time of all jobs scheduled.
  */
-float scheduler_average_turnaround_time()
+float scheduler_average_turnaround_time_r(scheduler_t *s)
 {
+	latency_histogram_t* turnaround = &s->latency_histograms[LATENCY_TURNAROUND];
 
-	int total_jobs = completed_queue->m_num_entries;
-
-	int total_turnaround_time = 0;
-	for(int x = 0; x < total_jobs; x++)
-	{
-		job_t* temp = priqueue_at(completed_queue, x);
-		total_turnaround_time = total_turnaround_time + (temp->completion_time
-					- temp->arrival_time);
-	}
-
-	//calculate the total amount of time from creation to completion, then divide
-	//by the total number of jobs
-	float average = (float)total_turnaround_time / (float)total_jobs;
+	//divide the total amount of time from creation to completion by the
+	//total number of jobs
+	float average = (float)turnaround->sum / (float)turnaround->count;
 
 	return(average);
 }
@@ -425,62 +1363,126 @@ float scheduler_average_turnaround_time()
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
   @return the average response time of all jobs scheduled.
  */
-float scheduler_average_response_time()
+float scheduler_average_response_time_r(scheduler_t *s)
 {
 	//response time is time from creation to first scheduling
-	
-	int total_jobs = completed_queue->m_num_entries;
+	latency_histogram_t* response = &s->latency_histograms[LATENCY_RESPONSE];
+
+	//divide the total amount of time spent waiting for first schedule by
+	//the total number of jobs
+	float average = (float)response->sum / (float)response->count;
+
+	return(average);
+}
+
 
-	int total_response_time = 0;
+/**
+  Summarizes one latency over every job that has finished so far: count,
+  mean, min, max and the 50th, 90th, 99th and 99.9th percentiles.
+
+  Percentiles are read from a fixed-size log-bucketed histogram, so they
+  are exact below 64 time units and within about 3% above that. Can be
+  called at any point, not just once scheduling is complete.
+
+  @param latency which latency to summarize
+  @param stats filled in with the summary; all zero if no job has finished
+ */
+void scheduler_latency_stats_r(scheduler_t *s, latency_t latency, latency_stats_t *stats)
+{
+	latency_histogram_t* histogram = &s->latency_histograms[latency];
 
-	for(int x = 0; x < total_jobs; x++)
+	memset(stats, 0, sizeof(*stats));
+	if(0 == histogram->count)
 	{
-		job_t* temp = priqueue_at(completed_queue, x);
-		total_response_time = total_response_time +
-				(temp->time_first_scheduled - temp->arrival_time);
+		return;
 	}
-	//Calculate the total amount of time spent waiting for first schedule, 
-	//then divide it by the total number of jobs
-	float average = (float)total_response_time / (float)total_jobs;
 
-	return(average);
+	stats->count = histogram->count;
+	stats->mean = (float)histogram->sum / (float)histogram->count;
+	stats->min = histogram->min;
+	stats->max = histogram->max;
+	stats->p50 = histogram_percentile(histogram, 0.5);
+	stats->p90 = histogram_percentile(histogram, 0.9);
+	stats->p99 = histogram_percentile(histogram, 0.99);
+	stats->p999 = histogram_percentile(histogram, 0.999);
+}
+
+
+/**
+  Returns how many of the jobs that have finished so far did so after
+  their deadline. The miss ratio is this over the count of
+  scheduler_latency_stats() for LATENCY_LATENESS, the number of finished
+  jobs that had a deadline.
+
+  @return the number of deadlines missed
+ */
+int scheduler_deadline_misses_r(scheduler_t *s)
+{
+	return(s->deadline_misses);
 }
 
 
 /**
-  Free any memory associated with your scheduler.
+  Free any memory associated with a scheduler, including the scheduler
+  itself.
  
   Assumptions:
-    - This function will be the last function called in your library.
+    - This function will be the last function called on s.
 */
-void scheduler_clean_up()
+void scheduler_destroy(scheduler_t *s)
 {
-	//free the array in the queue
-	priqueue_destroy(queue);
-
-	free(queue);//empty at this point, no need to iterate through the waiting queue
+	//free the array in the queue, empty at this point, no need to iterate
+	//through the waiting queue
+	if(NULL != s->queue)
+	{
+		priqueue_destroy(s->queue);
+		free(s->queue);
+	}
+	else if(s->active_scheme == SJF || s->active_scheme == PSJF)
+	{
+		sjf_queue_destroy(&s->ready.sjf);
+	}
+	else if(s->active_scheme == PRI || s->active_scheme == PPRI)
+	{
+		pri_queue_destroy(&s->ready.pri);
+	}
+	else if(s->active_scheme == CFS)
+	{
+		cfs_queue_destroy(&s->ready.cfs);
+	}
+	else if(s->active_scheme == EDF || s->active_scheme == PEDF)
+	{
+		edf_queue_destroy(&s->ready.edf);
+	}
 
-	int finished_size = completed_queue->m_size;
+	for(int x = 0; x < s->mlfq_levels; x++)
+	{
+		priqueue_destroy(&s->mlfq_queues[x]);
+	}
+	free(s->mlfq_queues);
 
-	for(int x = 0; x < finished_size; x++)
+	if(NULL != s->running_queue)
 	{
-		//free all the jobs in the completed queue
-		free(priqueue_poll(completed_queue));
+		priqueue_destroy(s->running_queue);
+		free(s->running_queue);
 	}
-	//free the array in the completed queue
-	priqueue_destroy(completed_queue);
-	//free the completed queue
-	free(completed_queue);
-	
-	for(int x = 0; x < m_num_cores; x++)
+
+	//free every job at once by releasing the slabs they live in
+	while(NULL != s->job_slabs)
 	{
-		//free all the cores in the core array
-		free(core_array[x]);
+		job_slab_t* next_slab = s->job_slabs->next;
+		free(s->job_slabs);
+		s->job_slabs = next_slab;
 	}
-	//free the core array
-	free(core_array);
 
+	free(s->batch_waiting);
+
+	//free the core array
+	free(s->core_array);
+	free(s->idle_cores);
+	free(s->idle_summary);
 
+	free(s);
 }
 
 
@@ -495,9 +1497,101 @@ void scheduler_clean_up()
   This function is not required and will not be graded. You may leave it
   blank if you do not find it useful.
  */
-void scheduler_show_queue()
+void scheduler_show_queue_r(scheduler_t *s)
+{
+
+}
+
+
+/*
+  The original interface: each call works on a default scheduler created by
+  scheduler_start_up() and released by scheduler_clean_up(). See the _r
+  functions above for what each one does.
+ */
+void scheduler_start_up(int cores, scheme_t scheme)
 {
+	default_scheduler = scheduler_create(cores, scheme);
+}
+
+void scheduler_mlfq_configure(int levels, int quantum, int boost_period)
+{
+	scheduler_mlfq_configure_r(default_scheduler, levels, quantum, boost_period);
+}
+
+void scheduler_cfs_configure(int granularity, int latency)
+{
+	scheduler_cfs_configure_r(default_scheduler, granularity, latency);
+}
+
+int scheduler_core_quantum(int core_id)
+{
+	return(scheduler_core_quantum_r(default_scheduler, core_id));
+}
+
+void scheduler_reserve_jobs(int job_count)
+{
+	scheduler_reserve_jobs_r(default_scheduler, job_count);
+}
+
+int scheduler_new_job(int job_number, int time, int running_time, int priority)
+{
+	return(scheduler_new_job_r(default_scheduler, job_number, time, running_time, priority));
+}
+
+int scheduler_new_job_deadline(int job_number, int time, int running_time, int priority, int deadline)
+{
+	return(scheduler_new_job_deadline_r(default_scheduler, job_number, time, running_time, priority, deadline));
+}
+
+int scheduler_new_jobs_batch(job_arrival_t *arrivals, int count, int time)
+{
+	return(scheduler_new_jobs_batch_r(default_scheduler, arrivals, count, time));
+}
+
+int scheduler_job_finished(int core_id, int job_number, int time)
+{
+	return(scheduler_job_finished_r(default_scheduler, core_id, job_number, time));
+}
+
+int scheduler_quantum_expired(int core_id, int time)
+{
+	return(scheduler_quantum_expired_r(default_scheduler, core_id, time));
+}
+
+float scheduler_average_waiting_time()
+{
+	return(scheduler_average_waiting_time_r(default_scheduler));
+}
+
+float scheduler_average_turnaround_time()
+{
+	return(scheduler_average_turnaround_time_r(default_scheduler));
+}
+
+float scheduler_average_response_time()
+{
+	return(scheduler_average_response_time_r(default_scheduler));
+}
+
+void scheduler_latency_stats(latency_t latency, latency_stats_t *stats)
+{
+	scheduler_latency_stats_r(default_scheduler, latency, stats);
+}
+
+int scheduler_deadline_misses()
+{
+	return(scheduler_deadline_misses_r(default_scheduler));
+}
+
+void scheduler_clean_up()
+{
+	scheduler_destroy(default_scheduler);
+	default_scheduler = NULL;
+}
 
+void scheduler_show_queue()
+{
+	scheduler_show_queue_r(default_scheduler);
 }
 
 int compare_FCFS(const void *a , const void *b)
@@ -511,64 +1605,87 @@ int compare_FCFS(const void *a , const void *b)
 
 }
 
-int compare_SJF(const void *a , const void *b)
+int compare_SJF(const void *a, const void *b)
 {
-	//checks time to completion, how much time is left to finish
-	//lower time left = higher priority
+	return(job_compare_SJF((job_t *) a, (job_t *) b));
+}
+
+int compare_PRI(const void *a, const void *b)
+{
+	return(job_compare_PRI((job_t *) a, (job_t *) b));
+}
+
+int compare_RR(const void *a, const void *b)
+{
+	//the new should always go on the end of the queue, so...
+	return(0);
+	//The new task should always get put on the end of the queue
+	//(because the insert function in priqueue starts at the end of the
+	//queue, inserting only when the addition's priority does not
+	//supercede the others)
+	//meaning that it will always insert at the end of the queue
+}
+
+int compare_CFS(const void *a, const void *b)
+{
+	return(job_compare_CFS((job_t *) a, (job_t *) b));
+}
+
+int compare_EDF(const void *a, const void *b)
+{
+	return(job_compare_EDF((job_t *) a, (job_t *) b));
+}
+
+int compare_running_SJF(const void *a, const void *b)
+{
+	//orders running jobs so the one a new arrival should preempt first
+	//comes out on top: the opposite of compare_SJF, ties going to the
+	//lower numbered core like a scan from core 0 would
 	job_t* job_a = (job_t *) a;
 	job_t* job_b = (job_t *) b;
 
-	int a_remainder = job_a->length - job_a->time_running;
-	int b_remainder = job_b->length - job_b->time_running;
-
-	if(a_remainder == b_remainder)
+	//a running job's time left shrinks by the same amount for every
+	//running job, so compare when each would finish instead. That
+	//stays fixed while the jobs run, so nothing needs re-keying
+	int a_finish = job_a->time_last_scheduled + job_a->length - job_a->time_running;
+	int b_finish = job_b->time_last_scheduled + job_b->length - job_b->time_running;
+	int return_value = a_finish - b_finish;
+	if(return_value == 0)
 	{
-		//If a arrived sooner, then it will be propagated up the queue
-		//(this checks based off of the arrival times)
-		return(job_a->arrival_time - job_b->arrival_time);
+		return_value = job_a->arrival_time - job_b->arrival_time;
 	}
-	else
+
+	if(return_value == 0)
 	{
-		//if a has less time left, returns a negative value and will
-		//propogate job_a further up the queue.
-		return(a_remainder - b_remainder);
+		return(job_a->core_id - job_b->core_id);
 	}
+	return(-return_value);
 }
 
-int compare_PRI(const void *a, const void *b)
+int compare_running_PRI(const void *a, const void *b)
 {
-	//Checks priority value. Lower number = higher priority
-	//tiebreak with arrival time.
-
-	//cast to job pointer
+	//same as compare_running_SJF, but the opposite of compare_PRI
 	job_t* job_a = (job_t *) a;
 	job_t* job_b = (job_t *) b;
 
-	int return_value = job_a->priority - job_b->priority;
+	int return_value = compare_PRI(a, b);
 	if(return_value == 0)
-	{ //both priorities are identical
-		//check priority based off of arrival time
-		return_value = job_a->arrival_time - job_b->arrival_time;
-		//both arrival times shouldn't be identical, as said by the
-		//documentation
-		return(return_value);
-	}
-	else
-	{	
-		//recall smaller values go to front of priority queue
-		//If a is less than b, this returns a negative value,
-		//signaling that a should propagate further up the queue
-		return(return_value);
+	{
+		return(job_a->core_id - job_b->core_id);
 	}
+	return(-return_value);
 }
 
-int compare_RR(const void *a, const void *b)
+int compare_running_EDF(const void *a, const void *b)
 {
-	//the new should always go on the end of the queue, so...
-	return(0);
-	//The new task should always get put on the end of the queue
-	//(because the insert function in priqueue starts at the end of the
-	//queue, inserting only when the addition's priority does not
-	//supercede the others)
-	//meaning that it will always insert at the end of the queue
+	//same as compare_running_SJF, but the opposite of compare_EDF
+	job_t* job_a = (job_t *) a;
+	job_t* job_b = (job_t *) b;
+
+	int return_value = compare_EDF(a, b);
+	if(return_value == 0)
+	{
+		return(job_a->core_id - job_b->core_id);
+	}
+	return(-return_value);
 }
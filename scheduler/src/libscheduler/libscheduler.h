@@ -7,15 +7,100 @@
 /**
   Constants which represent the different scheduling algorithms
 */
-typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR} scheme_t;
+typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR, MLFQ, CFS, EDF, PEDF} scheme_t;
 
+/**
+  MLFQ levels (one bit each in a 64-bit mask) and the defaults used until
+  scheduler_mlfq_configure() is called
+*/
+#define MLFQ_MAX_LEVELS 64
+#define MLFQ_DEFAULT_LEVELS 3
+#define MLFQ_DEFAULT_BOOST 100
+
+/**
+  CFS slice sizing used until scheduler_cfs_configure() is called
+*/
+#define CFS_DEFAULT_GRANULARITY 1
+#define CFS_DEFAULT_LATENCY 8
+
+/**
+  Deadline of a job that has none, see scheduler_new_job_deadline()
+*/
+#define NO_DEADLINE -1
+
+/**
+  One job passed to scheduler_new_jobs_batch(). The first four fields are
+  the arguments of scheduler_new_job_deadline(); the last two are filled in
+  with what admitting the job did
+*/
+typedef struct _job_arrival_t
+{
+	int job_number;
+	int running_time;
+	int priority;
+	int deadline;
+	int core_id; //core the job was put on, -1 if it waits
+	int preempted_job; //job it took the core from, -1 if the core was idle
+} job_arrival_t;
+
+/**
+  Latencies recorded for every finished job. LATENCY_LATENESS is how long
+  after its deadline a job finished (0 if it made it), and is only recorded
+  for jobs that have a deadline
+*/
+typedef enum {LATENCY_WAITING = 0, LATENCY_TURNAROUND, LATENCY_RESPONSE, LATENCY_LATENESS} latency_t;
+
+/**
+  Summary of one latency_t over the finished jobs, see scheduler_latency_stats()
+*/
+typedef struct _latency_stats_t
+{
+	int count;
+	float mean;
+	int min, max;
+	int p50, p90, p99, p999;
+} latency_stats_t;
+
+/**
+  One scheduler instance, see scheduler_create()
+*/
+typedef struct _scheduler_t scheduler_t;
+
+scheduler_t* scheduler_create                     (int cores, scheme_t scheme);
+void         scheduler_destroy                    (scheduler_t *s);
+void         scheduler_mlfq_configure_r           (scheduler_t *s, int levels, int quantum, int boost_period);
+void         scheduler_cfs_configure_r            (scheduler_t *s, int granularity, int latency);
+int          scheduler_core_quantum_r             (scheduler_t *s, int core_id);
+void         scheduler_reserve_jobs_r             (scheduler_t *s, int job_count);
+int          scheduler_new_job_r                  (scheduler_t *s, int job_number, int time, int running_time, int priority);
+int          scheduler_new_job_deadline_r         (scheduler_t *s, int job_number, int time, int running_time, int priority, int deadline);
+int          scheduler_new_jobs_batch_r           (scheduler_t *s, job_arrival_t *arrivals, int count, int time);
+int          scheduler_job_finished_r             (scheduler_t *s, int core_id, int job_number, int time);
+int          scheduler_quantum_expired_r          (scheduler_t *s, int core_id, int time);
+float        scheduler_average_turnaround_time_r  (scheduler_t *s);
+float        scheduler_average_waiting_time_r     (scheduler_t *s);
+float        scheduler_average_response_time_r    (scheduler_t *s);
+void         scheduler_latency_stats_r            (scheduler_t *s, latency_t latency, latency_stats_t *stats);
+int          scheduler_deadline_misses_r          (scheduler_t *s);
+void         scheduler_show_queue_r               (scheduler_t *s);
+
+//the original interface, working on a default scheduler made by
+//scheduler_start_up()
 void  scheduler_start_up               (int cores, scheme_t scheme);
+void  scheduler_mlfq_configure         (int levels, int quantum, int boost_period);
+void  scheduler_cfs_configure          (int granularity, int latency);
+int   scheduler_core_quantum           (int core_id);
+void  scheduler_reserve_jobs           (int job_count);
 int   scheduler_new_job                (int job_number, int time, int running_time, int priority);
+int   scheduler_new_job_deadline       (int job_number, int time, int running_time, int priority, int deadline);
+int   scheduler_new_jobs_batch         (job_arrival_t *arrivals, int count, int time);
 int   scheduler_job_finished           (int core_id, int job_number, int time);
 int   scheduler_quantum_expired        (int core_id, int time);
 float scheduler_average_turnaround_time();
 float scheduler_average_waiting_time   ();
 float scheduler_average_response_time  ();
+void  scheduler_latency_stats          (latency_t latency, latency_stats_t *stats);
+int   scheduler_deadline_misses        ();
 void  scheduler_clean_up               ();
 
 void  scheduler_show_queue             ();
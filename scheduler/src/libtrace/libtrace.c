@@ -0,0 +1,558 @@
+/** @file libtrace.c
+ *
+ * Loading job traces (CSV files) and running them through a scheduler,
+ * shared by the simulator and the sweep.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libtrace.h"
+#include "../libscheduler/libscheduler.h"
+
+
+/*
+ * Orders arrivals by time, then by job_id (their line in the input file).
+ */
+static int compare_arrivals(const void *a, const void *b)
+{
+	const simulator_arrival_t *arrival_a = a;
+	const simulator_arrival_t *arrival_b = b;
+
+	if (arrival_a->arrival_time != arrival_b->arrival_time)
+		return (arrival_a->arrival_time < arrival_b->arrival_time) ? -1 : 1;
+	return arrival_a->job_id - arrival_b->job_id;
+}
+
+
+/*
+ * Parses one integer CSV field starting at *cursor. Surrounding blanks are
+ * skipped; the field must end at a ',' or the end of the line. On success
+ * *cursor is left on the terminator and 1 is returned.
+ */
+static int parse_field(const char **cursor, const char *line_end, int *value)
+{
+	const char *p = *cursor;
+	long long result = 0;
+	int negative = 0, digits = 0;
+
+	while (p < line_end && (*p == ' ' || *p == '\t'))
+		p++;
+
+	if (p < line_end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	while (p < line_end && *p >= '0' && *p <= '9')
+	{
+		result = result * 10 + (*p - '0');
+		if (result > (long long)INT_MAX + 1)
+			return 0;
+		digits++;
+		p++;
+	}
+
+	while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+
+	if (digits == 0 || (p < line_end && *p != ','))
+		return 0;
+
+	if (negative)
+		result = -result;
+	if (result > INT_MAX || result < INT_MIN)
+		return 0;
+
+	*value = (int)result;
+	*cursor = p;
+	return 1;
+}
+
+/*
+ * Parses the optional deadline column, if *cursor is on the ',' that
+ * starts it. A missing or blank column is NO_DEADLINE; otherwise it must be
+ * a non-negative integer.
+ */
+static int parse_deadline(const char **cursor, const char *line_end, int *deadline)
+{
+	const char *p = *cursor;
+
+	*deadline = NO_DEADLINE;
+	if (p == line_end)
+		return 1;
+
+	p++;
+	while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+	if (p == line_end || *p == ',')
+		return 1;
+
+	(*cursor)++;
+	return parse_field(cursor, line_end, deadline) && *deadline >= 0;
+}
+
+/*
+ * Memory-maps file_name and parses every row after the header into a job
+ * array sized by a newline-counting prepass. The fourth column, a deadline
+ * relative to the arrival time, is optional and columns past it are
+ * ignored. A row with a negative arrival time or a run time under 1 is
+ * malformed. Prints the reason and returns NULL if the file cannot be loaded.
+ */
+simulator_job_list_t *load_jobs(char *file_name, int *job_count)
+{
+	int fd = open(file_name, O_RDONLY);
+	struct stat file_stat;
+
+	if (fd == -1 || fstat(fd, &file_stat) == -1)
+	{
+		fprintf(stderr, "Unable to open file \"%s\".\n", file_name);
+		if (fd != -1)
+			close(fd);
+		return NULL;
+	}
+
+	size_t file_size = file_stat.st_size;
+	const char *data = NULL;
+
+	if (file_size > 0)
+	{
+		data = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			fprintf(stderr, "Unable to open file \"%s\".\n", file_name);
+			close(fd);
+			return NULL;
+		}
+		madvise((void *)data, file_size, MADV_SEQUENTIAL);
+	}
+	close(fd);
+
+	const char *end = data + file_size;
+	const char *p;
+
+	// Every row ends in a newline, except possibly the last one
+	size_t rows = 1;
+	for (p = data; p < end && (p = memchr(p, '\n', end - p)) != NULL; p++)
+		rows++;
+
+	simulator_job_list_t *jobs = malloc(rows * sizeof(simulator_job_list_t));
+	if (jobs == NULL)
+	{
+		fprintf(stderr, "Out of memory.\n");
+		if (data != NULL)
+			munmap((void *)data, file_size);
+		return NULL;
+	}
+
+	int job_id = 0, line_number = 0;
+
+	for (p = data; p < end; )
+	{
+		const char *line_end = memchr(p, '\n', end - p);
+		if (line_end == NULL)
+			line_end = end;
+
+		line_number++;
+
+		// Ignore the first (header) line and blank lines
+		const char *cursor = p;
+		while (cursor < line_end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+			cursor++;
+
+		if (line_number > 1 && cursor < line_end)
+		{
+			int arrival_time, run_time, priority, deadline;
+			cursor = p;
+
+			if (!parse_field(&cursor, line_end, &arrival_time) || cursor++ == line_end ||
+			    !parse_field(&cursor, line_end, &run_time) || cursor++ == line_end ||
+			    !parse_field(&cursor, line_end, &priority) ||
+			    !parse_deadline(&cursor, line_end, &deadline) ||
+			    arrival_time < 0 || run_time <= 0)
+			{
+				fprintf(stderr, "Illegal file format on line %d.\n", line_number);
+				free(jobs);
+				munmap((void *)data, file_size);
+				return NULL;
+			}
+
+			jobs[job_id].job_id = job_id;
+			jobs[job_id].arrival_time = arrival_time;
+			jobs[job_id].run_time = run_time;
+			jobs[job_id].priority = priority;
+			jobs[job_id].deadline = deadline;
+			jobs[job_id].core_id = -1;
+			jobs[job_id].arrived = 0;
+
+			job_id++;
+		}
+
+		p = line_end + 1;
+	}
+
+	if (data != NULL)
+		munmap((void *)data, file_size);
+
+	*job_count = job_id;
+	return jobs;
+}
+
+
+/*
+ * Returns the jobs' arrivals ordered by time (ties in input file order), for
+ * delivering them from a cursor. The caller frees the array.
+ */
+simulator_arrival_t *sort_arrivals(simulator_job_list_t *jobs, int job_count)
+{
+	simulator_arrival_t *arrivals = malloc(job_count * sizeof(simulator_arrival_t));
+	int i, arrivals_sorted = 1;
+
+	if (arrivals == NULL)
+		return NULL;
+
+	for (i = 0; i < job_count; i++)
+	{
+		arrivals[i].arrival_time = jobs[i].arrival_time;
+		arrivals[i].job_id = jobs[i].job_id;
+
+		if (i > 0 && arrivals[i].arrival_time < arrivals[i - 1].arrival_time)
+			arrivals_sorted = 0;
+	}
+
+	if (!arrivals_sorted)
+		qsort(arrivals, job_count, sizeof(simulator_arrival_t), compare_arrivals);
+
+	return arrivals;
+}
+
+
+/*
+ * Puts job_id on core_id. job_slot maps a job_id to its index in jobs (-1
+ * once finished) and core_job maps a core to the job_id running on it (-1
+ * when idle); both are kept up to date here.
+ */
+static int set_active_job(int job_id, int core_id, simulator_job_list_t *jobs, int total_jobs, int *job_slot, int *core_job)
+{
+	if (job_id < 0 || job_id >= total_jobs || job_slot[job_id] == -1)
+		return 0;
+
+	simulator_job_list_t *job = &jobs[job_slot[job_id]];
+	if (!job->arrived)
+		return 0;
+
+	if (job->core_id != -1 && job->core_id != core_id && core_job[job->core_id] == job_id)
+		core_job[job->core_id] = -1;
+
+	job->core_id = core_id;
+	core_job[core_id] = job_id;
+	return 1;
+}
+
+
+/*
+ * The quantum of the job now on core_id: the same for every job under RR,
+ * set by the scheduler under MLFQ and CFS.
+ */
+static int core_quantum(scheduler_t *scheduler, int scheme, int quantum, int core_id)
+{
+	if (scheme == RR)
+		return quantum;
+	return scheduler_core_quantum_r(scheduler, core_id);
+}
+
+
+/*
+ * Runs the trace through scheduler (made and configured by the caller for
+ * scheme, with quantum as the RR quantum or the MLFQ/CFS one) until every
+ * job finishes, calling hooks (may be NULL) on every event.
+ *
+ * Each step handles the jobs that finished in the last time unit, then the
+ * quanta that expired, then the jobs arriving now (as one batch), and runs
+ * the cores for a time unit. When event_driven is set, it runs every unit
+ * up to the next arrival, completion or quantum expiry at once instead;
+ * nothing would have happened in the units skipped.
+ *
+ * jobs is updated in place (finished jobs are swap-deleted), arrivals comes
+ * from sort_arrivals() and *end_time is set to the time the run ended.
+ */
+trace_status_t trace_run(scheduler_t *scheduler, int scheme, int cores, int quantum, int event_driven,
+                         simulator_job_list_t *jobs, simulator_arrival_t *arrivals, int job_count,
+                         trace_hooks_t *hooks, int *end_time)
+{
+	trace_hooks_t no_hooks = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+	trace_status_t status = TRACE_OK;
+	int time = 0, i, j;
+	int total_jobs = job_count, active_jobs = job_count, jobs_alive = 0;
+
+	if (hooks == NULL)
+		hooks = &no_hooks;
+
+	// Schemes whose running jobs are switched out by quantum expiry
+	int uses_quantum = (scheme == RR || scheme == MLFQ || scheme == CFS);
+
+	/*
+	 * Arrivals are delivered from a cursor over the jobs ordered by arrival
+	 * time (ties in input file order). Because finished jobs are swap-deleted
+	 * from jobs[], job_slot[] tracks where each job_id currently lives.
+	 */
+	int *job_slot = malloc(total_jobs * sizeof(int));
+	int *core_job = malloc(cores * sizeof(int));
+	int *quantum_clock = malloc(cores * sizeof(int));
+	int *finished = malloc(cores * sizeof(int));
+	job_arrival_t *batch = malloc(total_jobs * sizeof(job_arrival_t));
+	int next_arrival = 0, finished_count, k;
+
+	for (i = 0; i < total_jobs; i++)
+		job_slot[i] = i;
+	for (i = 0; i < cores; i++)
+	{
+		quantum_clock[i] = -1;
+		core_job[i] = -1;
+	}
+
+	while (active_jobs > 0)
+	{
+		if (hooks->step)
+			hooks->step(hooks->arg, time);
+
+		/*
+		 * 1. Check if any jobs finished in the last time unit. Only jobs on a
+		 * core run, so only they can have, and every step stays O(cores)
+		 * rather than O(jobs) however many are still to arrive.
+		 */
+		finished_count = 0;
+		for (i = 0; i < cores; i++)
+			if (core_job[i] != -1 && jobs[job_slot[core_job[i]]].run_time == 0)
+				finished[finished_count++] = core_job[i];
+
+		while (finished_count > 0)
+		{
+			// They go in the order a scan of jobs[] would meet them: the
+			// lowest slot first, which may be the one a swap-delete just
+			// moved into a freed slot
+			k = 0;
+			for (j = 1; j < finished_count; j++)
+				if (job_slot[finished[j]] < job_slot[finished[k]])
+					k = j;
+			i = job_slot[finished[k]];
+			finished[k] = finished[--finished_count];
+
+			// Notify the scheduler has finished
+			int job_id = jobs[i].job_id;
+			int core_id = jobs[i].core_id;
+			int new_job_id = scheduler_job_finished_r(scheduler, core_id, job_id, time);
+
+			if (uses_quantum)
+				quantum_clock[core_id] = core_quantum(scheduler, scheme, quantum, core_id);
+
+			// Delete the finished jobs, decrease the number of active jobs
+			job_slot[job_id] = -1;
+			core_job[core_id] = -1;
+			if (i != active_jobs - 1)
+			{
+				jobs[i] = jobs[active_jobs - 1];
+				job_slot[jobs[i].job_id] = i;
+			}
+			active_jobs--;
+			jobs_alive--;
+
+			// Set the new job
+			if (new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, total_jobs, job_slot, core_job))
+			{
+				status = TRACE_INVALID_FINISHED_JOB;
+				if (hooks->invalid)
+					hooks->invalid(hooks->arg, status, new_job_id, jobs, active_jobs);
+				break;
+			}
+			if (hooks->finished)
+				hooks->finished(hooks->arg, time, job_id, core_id, new_job_id);
+		}
+
+		/*
+		 * Check to see if we finished our last job.  (If we don't check here, we would run an extra time unit that will be totally idle.)
+		 */
+		if (active_jobs == 0 || status != TRACE_OK)
+			break;
+
+		/*
+		 * 2. Check of any quantums expired in the last time unit.
+		 */
+		if (uses_quantum)
+		{
+			for (i = 0; i < cores; i++)
+			{
+				if (quantum_clock[i] == 0 && core_job[i] != -1)
+				{
+					j = job_slot[core_job[i]];
+
+					// Notify the scheduler the quantum has expired
+					int old_job_id = jobs[j].job_id;
+					int new_job_id = scheduler_quantum_expired_r(scheduler, i, time);
+
+					jobs[j].core_id = -1;
+					core_job[i] = -1;
+					quantum_clock[i] = core_quantum(scheduler, scheme, quantum, i);
+
+					// Set the new job
+					if (new_job_id != -1 && !set_active_job(new_job_id, i, jobs, total_jobs, job_slot, core_job))
+					{
+						status = TRACE_INVALID_EXPIRED_JOB;
+						if (hooks->invalid)
+							hooks->invalid(hooks->arg, status, new_job_id, jobs, active_jobs);
+						break;
+					}
+					if (hooks->expired)
+						hooks->expired(hooks->arg, time, old_job_id, i, new_job_id);
+				}
+			}
+
+			if (status != TRACE_OK)
+				break;
+		}
+
+		/*
+		 * 3. Check for any new jobs that arrive in this time unit. They are
+		 * admitted in one batch, then each one's outcome is applied in turn
+		 * (a job may be preempted by a later one of the same batch).
+		 */
+		int batch_count = 0;
+		while (next_arrival < total_jobs && arrivals[next_arrival].arrival_time <= time)
+		{
+			i = job_slot[arrivals[next_arrival++].job_id];
+
+			batch[batch_count].job_number = jobs[i].job_id;
+			batch[batch_count].running_time = jobs[i].run_time;
+			batch[batch_count].priority = jobs[i].priority;
+			batch[batch_count].deadline = jobs[i].deadline;
+			batch_count++;
+		}
+
+		if (batch_count > 0)
+			scheduler_new_jobs_batch_r(scheduler, batch, batch_count, time);
+
+		for (j = 0; j < batch_count; j++)
+		{
+			i = job_slot[batch[j].job_number];
+
+			int new_job_core_id = batch[j].core_id;
+			jobs[i].arrived = 1;
+			jobs_alive++;
+
+			if (new_job_core_id < -1 || new_job_core_id >= cores)
+			{
+				status = TRACE_INVALID_CORE;
+				if (hooks->invalid)
+					hooks->invalid(hooks->arg, status, new_job_core_id, jobs, active_jobs);
+				break;
+			}
+
+			if (hooks->arrived)
+				hooks->arrived(hooks->arg, time, &jobs[i], new_job_core_id);
+
+			if (new_job_core_id != -1)
+			{
+				// Find if anyone is currently using the core.
+				if (core_job[new_job_core_id] != -1)
+					jobs[job_slot[core_job[new_job_core_id]]].core_id = -1;
+
+				// Assign the core to the new job
+				jobs[i].core_id = new_job_core_id;
+				core_job[new_job_core_id] = jobs[i].job_id;
+
+				if (uses_quantum)
+					quantum_clock[new_job_core_id] = core_quantum(scheduler, scheme, quantum, new_job_core_id);
+			}
+		}
+
+		if (status != TRACE_OK)
+			break;
+
+		/*
+		 * 4. Run the time unit, or every unit up to the next event.
+		 */
+		int time_units = 1;
+
+		if (event_driven)
+		{
+			int next_event = -1;
+
+			if (next_arrival < total_jobs)
+				next_event = arrivals[next_arrival].arrival_time;
+
+			for (i = 0; i < cores; i++)
+			{
+				if (core_job[i] == -1)
+					continue;
+
+				int job_event = time + jobs[job_slot[core_job[i]]].run_time;
+
+				if (uses_quantum && time + quantum_clock[i] < job_event)
+					job_event = time + quantum_clock[i];
+
+				if (job_event > time && (next_event == -1 || job_event < next_event))
+					next_event = job_event;
+			}
+
+			if (next_event != -1)
+				time_units = next_event - time;
+		}
+
+		int cores_working = 0;
+
+		for (i = 0; i < cores; i++)
+		{
+			if (core_job[i] != -1)
+			{
+				simulator_job_list_t *job = &jobs[job_slot[core_job[i]]];
+
+				cores_working++;
+				job->run_time -= time_units;
+				quantum_clock[i] -= time_units;
+
+				assert(job->core_id == i);
+			}
+		}
+
+		if (hooks->ran && !hooks->ran(hooks->arg, time, time_units, core_job))
+		{
+			status = TRACE_STOPPED;
+			break;
+		}
+
+		/*
+		 * 5. Sanity Checking
+		 *
+		 * - If there's a job alive (needing to be ran) and all CPUs are idle, the scheduler failed to schedule properly.
+		 */
+		if (jobs_alive > 0 && cores_working == 0)
+		{
+			status = TRACE_ALL_IDLE;
+			if (hooks->invalid)
+				hooks->invalid(hooks->arg, status, -1, jobs, active_jobs);
+			break;
+		}
+
+		/*
+		 * 6. Increase time
+		 */
+		time += time_units;
+	}
+
+	*end_time = time;
+
+	free(batch);
+	free(finished);
+	free(quantum_clock);
+	free(core_job);
+	free(job_slot);
+	return status;
+}
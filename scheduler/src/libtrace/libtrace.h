@@ -0,0 +1,69 @@
+/** @file libtrace.h
+ */
+
+#ifndef LIBTRACE_H_
+#define LIBTRACE_H_
+
+#include "../libscheduler/libscheduler.h"
+
+/*
+ * One job of a trace: the CSV columns plus the state the simulator keeps
+ * for it while it runs. deadline is relative to the arrival time, and
+ * NO_DEADLINE (-1) when the optional fourth column is missing or blank.
+ */
+typedef struct _simulator_job_list_t
+{
+	int job_id, arrival_time, run_time, priority, deadline;
+	int core_id, arrived;
+} simulator_job_list_t;
+
+typedef struct _simulator_arrival_t
+{
+	int arrival_time, job_id;
+} simulator_arrival_t;
+
+/*
+ * How a trace_run() ended. Anything but TRACE_OK stops the run at once.
+ */
+typedef enum
+{
+	TRACE_OK = 0,
+	TRACE_INVALID_FINISHED_JOB, // scheduler_job_finished() picked a job that cannot run
+	TRACE_INVALID_EXPIRED_JOB,  // scheduler_quantum_expired() did
+	TRACE_INVALID_CORE,         // scheduler_new_jobs_batch() picked a core that does not exist
+	TRACE_ALL_IDLE,             // every core idle with jobs still waiting
+	TRACE_STOPPED               // the ran hook asked to stop
+} trace_status_t;
+
+/*
+ * Called by trace_run() as the run goes, so the simulator can report every
+ * event and the sweep can stay quiet. arg is passed to each of them, and
+ * any of them may be NULL.
+ */
+typedef struct _trace_hooks_t
+{
+	void *arg;
+
+	// A new step starts at time, before anything has happened in it
+	void (*step)(void *arg, int time);
+	// job_id finished on core_id, which now runs new_job_id (-1 for none)
+	void (*finished)(void *arg, int time, int job_id, int core_id, int new_job_id);
+	// job_id's quantum expired on core_id, which now runs new_job_id
+	void (*expired)(void *arg, int time, int job_id, int core_id, int new_job_id);
+	// job arrived and was put on core_id (-1 to wait)
+	void (*arrived)(void *arg, int time, simulator_job_list_t *job, int core_id);
+	// Each core ran core_job[core] (-1 when idle) for time_units from time.
+	// Returns 0 to stop the run with TRACE_STOPPED.
+	int (*ran)(void *arg, int time, int time_units, const int *core_job);
+	// The run is stopping because the scheduler went wrong: value is the
+	// job or core it picked, and jobs[0..active_jobs) those not finished
+	void (*invalid)(void *arg, trace_status_t status, int value, simulator_job_list_t *jobs, int active_jobs);
+} trace_hooks_t;
+
+simulator_job_list_t *load_jobs(char *file_name, int *job_count);
+simulator_arrival_t  *sort_arrivals(simulator_job_list_t *jobs, int job_count);
+trace_status_t        trace_run(scheduler_t *scheduler, int scheme, int cores, int quantum, int event_driven,
+                                simulator_job_list_t *jobs, simulator_arrival_t *arrivals, int job_count,
+                                trace_hooks_t *hooks, int *end_time);
+
+#endif /* LIBTRACE_H_ */
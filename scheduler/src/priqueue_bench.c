@@ -0,0 +1,358 @@
+/** @file priqueue_bench.c
+ *
+ * Microbenchmarks for libpriqueue: ns per operation and allocations for
+ * offer, poll, remove and a mixed poll+offer workload, over every queue
+ * mode (plus "sortkey", sorted mode made by priqueue_init_keyed(), and
+ * "typed" and "keyed", PRIQUEUE_DEFINE_TYPED and PRIQUEUE_DEFINE_KEYED
+ * heaps of int, which have no remove), several key orders and queue sizes
+ * from 10 up. Prints one CSV row
+ * per (mode, keys, size, op) so runs can be diffed between commits.
+ *
+ * Allocations are counted by wrapping malloc/calloc/realloc at link time
+ * (see the priqueue_bench target in the Makefile).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "libpriqueue/libpriqueue.h"
+
+// Every (mode, keys, size) is repeated until it has done this many offers
+// or spent this long (but at least once), so small queues are timed over
+// many runs without large ones taking forever
+#define BENCH_TARGET_OPS 1000000
+#define BENCH_TIME_BUDGET_NS 200e6
+
+// Sorted mode offers are O(n), so it stops at this size unless -a is given
+#define BENCH_SORTED_MAX_SIZE 10000
+
+// Removes are O(n) in every mode; each run does about this much work
+#define BENCH_REMOVE_BUDGET 10000000
+
+
+/*
+ * Allocation counters, bumped by the --wrap'd allocator below. volatile
+ * because the compiler assumes malloc() leaves them alone, which would let
+ * it keep them in registers around the typed queue's inlined allocations.
+ */
+static volatile long long alloc_count = 0;
+static volatile long long alloc_bytes = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+	alloc_count++;
+	alloc_bytes += size;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+	alloc_count++;
+	alloc_bytes += count * size;
+	return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	alloc_count++;
+	alloc_bytes += size;
+	return __real_realloc(ptr, size);
+}
+
+
+typedef enum {KEYS_RANDOM = 0, KEYS_ASCENDING, KEYS_DESCENDING, KEYS_EQUAL} bench_keys_t;
+
+// not priqueue_mode_t's: the PRIQUEUE_DEFINE_TYPED and _KEYED heaps below,
+// and PRIQUEUE_SORTED made by priqueue_init_keyed()
+#define BENCH_TYPED (PRIQUEUE_FIFO + 1)
+#define BENCH_KEYED (PRIQUEUE_FIFO + 2)
+#define BENCH_SORTED_KEYED (PRIQUEUE_FIFO + 3)
+
+static const char *mode_names[] = { "sorted", "heap", "fifo", "typed", "keyed", "sortkey" };
+static const char *key_names[] = { "random", "ascending", "descending", "equal" };
+
+/*
+ * One timed phase of a run: total time, operations and allocations over
+ * every repetition.
+ */
+typedef struct _bench_phase_t
+{
+	long long ops;
+	double ns;
+	long long allocs, bytes;
+} bench_phase_t;
+
+enum {PHASE_OFFER = 0, PHASE_REMOVE, PHASE_MIXED, PHASE_POLL, PHASE_COUNT};
+
+int compare_int(const void *a, const void *b)
+{
+	int key_a = *(const int *)a;
+	int key_b = *(const int *)b;
+	return (key_a > key_b) - (key_a < key_b);
+}
+
+unsigned long long key_int_ptr(const void *a)
+{
+	return (unsigned long long)(unsigned int)*(const int *)a ^ 0x80000000ULL;
+}
+
+// all keys equal, like compare_RR in libscheduler
+int compare_equal(const void *a, const void *b)
+{
+	return 0;
+}
+
+static inline int compare_int_typed(const int *a, const int *b)
+{
+	return (*a > *b) - (*a < *b);
+}
+
+PRIQUEUE_DEFINE_TYPED(int_queue, int, compare_int_typed)
+
+static inline unsigned long long key_int(const int *a)
+{
+	return (unsigned long long)(unsigned int)*a ^ 0x80000000ULL;
+}
+
+PRIQUEUE_DEFINE_KEYED(key_queue, int, key_int)
+
+static unsigned long long bench_random_state = 0x9E3779B97F4A7C15ULL;
+
+// xorshift64, seeded the same every run so results are comparable
+unsigned long long bench_random()
+{
+	bench_random_state ^= bench_random_state << 13;
+	bench_random_state ^= bench_random_state >> 7;
+	bench_random_state ^= bench_random_state << 17;
+	return bench_random_state;
+}
+
+double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Fills keys[0..count) in the given order. The second half continues the
+ * first, so the mixed phase keeps offering keys in the same order.
+ */
+void make_keys(int *keys, int count, bench_keys_t order)
+{
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		if (order == KEYS_RANDOM)
+			keys[i] = (int)(bench_random() % 1000000000);
+		else if (order == KEYS_ASCENDING)
+			keys[i] = i;
+		else if (order == KEYS_DESCENDING)
+			keys[i] = count - i;
+		else
+			keys[i] = 0;
+	}
+}
+
+/*
+ * Time one phase of a run into phases[phase], along with the allocations it
+ * made. The run declares phases, start, start_allocs and start_bytes.
+ */
+#define PHASE_BEGIN() (start_allocs = alloc_count, start_bytes = alloc_bytes, start = now_ns())
+#define PHASE_END(phase, op_count) do { \
+		phases[phase].ns += now_ns() - start; \
+		phases[phase].ops += (op_count); \
+		phases[phase].allocs += alloc_count - start_allocs; \
+		phases[phase].bytes += alloc_bytes - start_bytes; \
+	} while (0)
+
+/*
+ * One run over a queue of size elements:
+ *   offer  - offer size elements into an empty queue
+ *   remove - priqueue_remove() a spread of those elements (re-offered untimed)
+ *   mixed  - size poll+offer pairs at a steady queue size
+ *   poll   - poll the queue empty
+ */
+void bench_run(int mode, int size, int *keys, int (*comparer)(const void *, const void *), bench_phase_t *phases)
+{
+	priqueue_t q;
+	int i;
+	double start;
+	long long start_allocs, start_bytes;
+
+	PHASE_BEGIN();
+	if (mode == BENCH_SORTED_KEYED)
+		priqueue_init_keyed(&q, key_int_ptr);
+	else
+		priqueue_init_mode(&q, comparer, mode);
+	for (i = 0; i < size; i++)
+		priqueue_offer(&q, &keys[i]);
+	PHASE_END(PHASE_OFFER, size);
+
+	long long removes = BENCH_REMOVE_BUDGET / size;
+	if (removes < 1)
+		removes = 1;
+	if (removes > size)
+		removes = size;
+	int stride = size / removes;
+
+	PHASE_BEGIN();
+	for (i = 0; i < removes; i++)
+		priqueue_remove(&q, &keys[i * stride]);
+	PHASE_END(PHASE_REMOVE, removes);
+
+	for (i = 0; i < removes; i++)
+		priqueue_offer(&q, &keys[i * stride]);
+
+	PHASE_BEGIN();
+	for (i = 0; i < size; i++)
+	{
+		priqueue_poll(&q);
+		priqueue_offer(&q, &keys[size + i]);
+	}
+	PHASE_END(PHASE_MIXED, size);
+
+	PHASE_BEGIN();
+	while (priqueue_poll(&q) != NULL)
+		;
+	PHASE_END(PHASE_POLL, size);
+
+	priqueue_destroy(&q);
+}
+
+/*
+ * bench_run() for the typed and keyed heaps, minus the remove phase.
+ */
+#define BENCH_RUN_QUEUE(function, queue) \
+void function(int size, int *keys, bench_phase_t *phases) \
+{ \
+	queue##_t q; \
+	int i; \
+	double start; \
+	long long start_allocs, start_bytes; \
+\
+	PHASE_BEGIN(); \
+	queue##_init(&q); \
+	for (i = 0; i < size; i++) \
+		queue##_offer(&q, &keys[i]); \
+	PHASE_END(PHASE_OFFER, size); \
+\
+	PHASE_BEGIN(); \
+	for (i = 0; i < size; i++) \
+	{ \
+		queue##_poll(&q); \
+		queue##_offer(&q, &keys[size + i]); \
+	} \
+	PHASE_END(PHASE_MIXED, size); \
+\
+	PHASE_BEGIN(); \
+	while (queue##_poll(&q) != NULL) \
+		; \
+	PHASE_END(PHASE_POLL, size); \
+\
+	queue##_destroy(&q); \
+}
+
+BENCH_RUN_QUEUE(bench_run_typed, int_queue)
+BENCH_RUN_QUEUE(bench_run_keyed, key_queue)
+
+#undef BENCH_RUN_QUEUE
+#undef PHASE_BEGIN
+#undef PHASE_END
+
+void print_usage(char *program_name)
+{
+	fprintf(stderr, "Usage: %s [-n <max size>] [-a]\n", program_name);
+	fprintf(stderr, "  -n  largest queue size to run, sizes go 10, 100, ... (default: 1000000)\n");
+	fprintf(stderr, "  -a  also run sorted mode above %d elements\n", BENCH_SORTED_MAX_SIZE);
+}
+
+int main(int argc, char **argv)
+{
+	int c, max_size = 1000000, all_sorted = 0;
+
+	while ((c = getopt(argc, argv, "n:a")) != -1)
+	{
+		switch (c)
+		{
+			case 'n':
+				max_size = atoi(optarg);
+				if (max_size < 10)
+				{
+					fprintf(stderr, "Option -n <max size> requires a number of at least 10.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'a':
+				all_sorted = 1;
+				break;
+
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	printf("mode,keys,size,op,ops,ns_per_op,allocs_per_run,bytes_per_run\n");
+
+	int *keys = malloc(2 * (size_t)max_size * sizeof(int));
+	int mode, order, size, phase;
+
+	for (mode = PRIQUEUE_SORTED; mode <= BENCH_SORTED_KEYED; mode++)
+	{
+		for (order = KEYS_RANDOM; order <= KEYS_EQUAL; order++)
+		{
+			// FIFO mode never calls the comparer, so it is only correct
+			// (and only used) when every key is equal
+			if (mode == PRIQUEUE_FIFO && order != KEYS_EQUAL)
+				continue;
+
+			for (size = 10; size <= max_size; size *= 10)
+			{
+				if ((mode == PRIQUEUE_SORTED || mode == BENCH_SORTED_KEYED) && size > BENCH_SORTED_MAX_SIZE && !all_sorted)
+					break;
+
+				bench_phase_t phases[PHASE_COUNT];
+				const char *phase_names[] = { "offer", "remove", "mixed", "poll" };
+				int runs = 0;
+				double start = now_ns();
+
+				memset(phases, 0, sizeof(phases));
+				make_keys(keys, 2 * size, order);
+
+				do
+				{
+					if (mode == BENCH_TYPED)
+						bench_run_typed(size, keys, phases);
+					else if (mode == BENCH_KEYED)
+						bench_run_keyed(size, keys, phases);
+					else
+						bench_run(mode, size, keys, (order == KEYS_EQUAL) ? compare_equal : compare_int, phases);
+					runs++;
+				} while ((long long)runs * size < BENCH_TARGET_OPS && now_ns() - start < BENCH_TIME_BUDGET_NS);
+
+				for (phase = 0; phase < PHASE_COUNT; phase++)
+				{
+					if (phases[phase].ops == 0)
+						continue; // typed and keyed have no remove phase
+					printf("%s,%s,%d,%s,%lld,%.2f,%.2f,%.0f\n", mode_names[mode], key_names[order], size,
+							phase_names[phase], phases[phase].ops, phases[phase].ns / phases[phase].ops,
+							(double)phases[phase].allocs / runs, (double)phases[phase].bytes / runs);
+				}
+				fflush(stdout);
+			}
+		}
+	}
+
+	free(keys);
+	return 0;
+}
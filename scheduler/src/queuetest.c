@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 
 #include "libpriqueue/libpriqueue.h"
 
@@ -16,6 +17,35 @@ int compare2(const void * a, const void * b)
 	return ( *(int*)b - *(int*)a );
 }
 
+int compare_equal(const void * a, const void * b)
+{
+	return 0;
+}
+
+static inline int compare_typed(const int * a, const int * b)
+{
+	return ( (*a > *b) - (*a < *b) );
+}
+
+PRIQUEUE_DEFINE_TYPED(int_queue, int, compare_typed)
+
+static inline unsigned long long key_typed(const int * a)
+{
+	return ( (unsigned long long)(unsigned int)*a ^ 0x80000000ULL );
+}
+
+PRIQUEUE_DEFINE_KEYED(key_queue, int, key_typed)
+
+unsigned long long key1(const void * a)
+{
+	return ( (unsigned long long)(unsigned int)*(int*)a ^ 0x80000000ULL );
+}
+
+unsigned long long key_raw(const void * a)
+{
+	return ( *(const unsigned long long*)a );
+}
+
 int main()
 {
 	priqueue_t q, q2;
@@ -76,6 +106,312 @@ int main()
 	priqueue_destroy(&q2);
 	priqueue_destroy(&q);
 
+
+	/* Same checks against the heap layout. */
+	priqueue_t h, h2;
+	priqueue_init_mode(&h, compare1, PRIQUEUE_HEAP);
+	priqueue_init_mode(&h2, compare_equal, PRIQUEUE_HEAP);
+
+	priqueue_offer(&h, &values[12]);
+	priqueue_offer(&h, &values[13]);
+	priqueue_offer(&h, &values[14]);
+	priqueue_offer(&h, &values[12]);
+	priqueue_offer(&h, &values[12]);
+	printf("Heap total elements: %d (expected 5).\n", priqueue_size(&h));
+	printf("Heap top element: %d (expected 12).\n", *((int *)priqueue_poll(&h)));
+	printf("Heap elements removed: %d (expected 2).\n", priqueue_remove(&h, &values[12]));
+
+	priqueue_offer(&h, &values[10]);
+	priqueue_offer(&h, &values[30]);
+	priqueue_offer(&h, &values[20]);
+
+	printf("Heap poll order (expected 10 13 14 20 30): ");
+	while (priqueue_size(&h) > 0)
+		printf("%d ", *((int *)priqueue_poll(&h)) );
+	printf("\n");
+
+	/* Equal keys must come back in insertion order, across a resize. */
+	for (i = 0; i < 100; i++)
+		priqueue_offer(&h2, &values[i]);
+	int in_order = 1;
+	for (i = 0; i < 100; i++)
+		if (*((int *)priqueue_poll(&h2)) != i)
+			in_order = 0;
+	printf("Heap equal keys polled FIFO: %d (expected 1).\n", in_order);
+
+	priqueue_destroy(&h2);
+	priqueue_destroy(&h);
+
+
+	/* Handles: remove and re-key elements in place. */
+	priqueue_t k;
+	priqueue_init_mode(&k, compare1, PRIQUEUE_HEAP);
+	int keys[10], handles[10];
+	for (i = 0; i < 10; i++)
+	{
+		keys[i] = 10 * i;
+		handles[i] = priqueue_offer(&k, &keys[i]);
+	}
+
+	keys[7] = -5;
+	priqueue_update_key(&k, handles[7]);
+	printf("Re-keyed top element: %d (expected -5).\n", *((int *)priqueue_peek(&k)));
+
+	keys[0] = 55;
+	priqueue_update_key(&k, handles[0]);
+	printf("Removed by handle: %d (expected 30).\n", *((int *)priqueue_remove_handle(&k, handles[3])));
+	printf("Stale handle removes: %d (expected 1).\n", priqueue_remove_handle(&k, handles[3]) == NULL);
+
+	printf("Handle queue poll order (expected -5 10 20 40 50 55 60 80 90): ");
+	while (priqueue_size(&k) > 0)
+		printf("%d ", *((int *)priqueue_poll(&k)) );
+	printf("\n");
+
+	priqueue_destroy(&k);
+
+
+	/* FIFO ring: offer order regardless of the comparer, across wraps and a resize. */
+	priqueue_t f;
+	priqueue_init_mode(&f, compare1, PRIQUEUE_FIFO);
+	int *ring_values = malloc(100 * sizeof(int));
+	for (i = 0; i < 100; i++)
+		ring_values[i] = 100 + i;
+
+	for (i = 0; i < 50; i++)
+		priqueue_offer(&f, &ring_values[99 - i]);
+	for (i = 0; i < 40; i++)
+		priqueue_poll(&f);
+	for (i = 0; i < 80; i++)
+		priqueue_offer(&f, &values[i]);
+	printf("FIFO total elements: %d (expected 90).\n", priqueue_size(&f));
+	printf("FIFO head and tail: %d %d (expected 159 79).\n",
+		*((int *)priqueue_peek(&f)), *((int *)priqueue_at(&f, priqueue_size(&f) - 1)));
+	printf("FIFO elements removed: %d (expected 1).\n", priqueue_remove(&f, &ring_values[55]));
+	in_order = 1;
+	for (i = 59; i >= 50; i--)
+		if (i != 55 && *((int *)priqueue_poll(&f)) != 100 + i)
+			in_order = 0;
+	for (i = 0; i < 80; i++)
+		if (*((int *)priqueue_poll(&f)) != i)
+			in_order = 0;
+	printf("FIFO polled in offer order: %d (expected 1).\n", in_order);
+
+	free(ring_values);
+	priqueue_destroy(&f);
+
+
+	/* Bulk offers come out in the same order as one offer per element. */
+	priqueue_t b, b2, bf;
+	priqueue_init_mode(&b, compare1, PRIQUEUE_HEAP);
+	priqueue_init_mode(&b2, compare1, PRIQUEUE_HEAP);
+	priqueue_init_mode(&bf, compare1, PRIQUEUE_FIFO);
+	void *batch[100];
+	for (i = 0; i < 100; i++)
+		batch[i] = (i < 3) ? &values[(i * 37) % 10 * 10] : &values[(99 - i) / 2];
+
+	priqueue_offer(&b, &values[50]);
+	priqueue_offer_many(&b, batch, 3); /* sifted up */
+	priqueue_offer_many(&b, batch + 3, 97); /* descending pairs: rebuilt */
+	priqueue_offer(&b2, &values[50]);
+	for (i = 0; i < 100; i++)
+		priqueue_offer(&b2, batch[i]);
+	printf("Heap bulk total elements: %d (expected 101).\n", priqueue_size(&b));
+	in_order = 1;
+	while (priqueue_size(&b2) > 0)
+		if (priqueue_poll(&b) != priqueue_poll(&b2))
+			in_order = 0;
+	printf("Heap bulk polled like single offers: %d (expected 1).\n", in_order);
+
+	for (i = 0; i < 40; i++)
+		priqueue_offer(&bf, &values[i]);
+	for (i = 0; i < 30; i++)
+		priqueue_poll(&bf);
+	priqueue_offer_many(&bf, batch, 100);
+	in_order = 1;
+	for (i = 30; i < 40; i++)
+		if (priqueue_poll(&bf) != &values[i])
+			in_order = 0;
+	for (i = 0; i < 100; i++)
+		if (priqueue_poll(&bf) != batch[i])
+			in_order = 0;
+	printf("FIFO bulk polled in offer order: %d (expected 1).\n", in_order);
+
+	priqueue_destroy(&bf);
+	priqueue_destroy(&b2);
+	priqueue_destroy(&b);
+
+	/* The typed and keyed heaps hand out the same elements, in the same order, as a heap priqueue_t. */
+	int_queue_t t;
+	key_queue_t kt;
+	priqueue_t th;
+	int_queue_init(&t);
+	key_queue_init(&kt);
+	priqueue_init_mode(&th, compare1, PRIQUEUE_HEAP);
+	int tkeys[200];
+	int *tptrs[200];
+	for (i = 0; i < 200; i++)
+	{
+		tkeys[i] = (i < 100) ? (i * 37) % 50 : 99 - i; /* ties, then descending below them */
+		tptrs[i] = &tkeys[i];
+	}
+
+	for (i = 0; i < 60; i++)
+	{
+		int_queue_offer(&t, tptrs[i]);
+		key_queue_offer(&kt, tptrs[i]);
+		priqueue_offer(&th, tptrs[i]);
+	}
+	in_order = 1;
+	int key_order = 1;
+	for (i = 0; i < 30; i++)
+	{
+		void *head = priqueue_poll(&th);
+		if (int_queue_poll(&t) != head)
+			in_order = 0;
+		if (key_queue_poll(&kt) != head)
+			key_order = 0;
+	}
+	for (i = 60; i < 100; i++)
+	{
+		int_queue_offer(&t, tptrs[i]);
+		key_queue_offer(&kt, tptrs[i]);
+		priqueue_offer(&th, tptrs[i]);
+	}
+	int_queue_offer_many(&t, tptrs + 100, 100); /* rebuilt */
+	key_queue_offer_many(&kt, tptrs + 100, 100);
+	for (i = 100; i < 200; i++)
+		priqueue_offer(&th, tptrs[i]);
+	printf("Typed heap total elements: %d (expected 170).\n", int_queue_size(&t));
+	printf("Typed heap top element: %d (expected -100).\n", *int_queue_peek(&t));
+	printf("Keyed heap top element: %d (expected -100).\n", *key_queue_peek(&kt));
+	while (priqueue_size(&th) > 0)
+	{
+		void *head = priqueue_poll(&th);
+		if (int_queue_poll(&t) != head)
+			in_order = 0;
+		if (key_queue_poll(&kt) != head)
+			key_order = 0;
+	}
+	printf("Typed heap polled like priqueue heap: %d (expected 1).\n", in_order);
+	printf("Keyed heap polled like priqueue heap: %d (expected 1).\n", key_order);
+	printf("Typed heap empty poll: %d (expected 1).\n", int_queue_poll(&t) == NULL);
+
+	priqueue_destroy(&th);
+	key_queue_destroy(&kt);
+	int_queue_destroy(&t);
+
+	/* Keyed sorted queue: same order as the comparer, ties in insertion order, across resizes. */
+	priqueue_t sk, sc;
+	priqueue_init_keyed(&sk, key1);
+	priqueue_init(&sc, compare1);
+	int skeys[300];
+	for (i = 0; i < 300; i++)
+		skeys[i] = (i * 7919) % 97 - 40;
+
+	in_order = 1;
+	for (i = 0; i < 300; i++)
+		if (priqueue_offer(&sk, &skeys[i]) != priqueue_offer(&sc, &skeys[i]))
+			in_order = 0;
+	for (i = 0; i < 20; i++)
+		if (priqueue_poll(&sk) != priqueue_poll(&sc))
+			in_order = 0;
+	priqueue_remove_at(&sk, 100);
+	priqueue_remove_at(&sc, 100);
+	printf("Keyed sorted elements removed: %d (expected 1).\n", priqueue_remove(&sk, &skeys[150]));
+	priqueue_remove(&sc, &skeys[150]);
+	for (i = 0; i < 50; i++)
+		if (priqueue_offer(&sk, &skeys[i]) != priqueue_offer(&sc, &skeys[i]))
+			in_order = 0;
+	printf("Keyed sorted total elements: %d (expected 328).\n", priqueue_size(&sk));
+	for (i = 0; i < priqueue_size(&sk); i++)
+		if (priqueue_at(&sk, i) != priqueue_at(&sc, i))
+			in_order = 0;
+	printf("Keyed sorted in comparer order: %d (expected 1).\n", in_order);
+
+	priqueue_destroy(&sc);
+	priqueue_destroy(&sk);
+
+	/* Keyed sorted search windows of every size up to 64 keys, ties and keys either side of the sign bit. */
+	const unsigned long long wvalues[] = { 0, 1, 5, LLONG_MAX, (unsigned long long)LLONG_MAX + 1, (unsigned long long)LLONG_MAX + 2, ULLONG_MAX };
+	unsigned long long wkeys[64];
+	priqueue_t wk;
+	priqueue_init_keyed(&wk, key_raw);
+	int right_index = 1;
+	for (i = 0; i < 64; i++)
+	{
+		wkeys[i] = wvalues[(i * 5) % 7];
+		int expected = 0, j;
+		for (j = 0; j < i; j++)
+			if (wkeys[j] <= wkeys[i])
+				expected++;
+		if (priqueue_offer(&wk, &wkeys[i]) != expected)
+			right_index = 0;
+	}
+	printf("Keyed sorted window offers at the right index: %d (expected 1).\n", right_index);
+	in_order = 1;
+	for (i = 1; i < priqueue_size(&wk); i++)
+	{
+		unsigned long long *prev = priqueue_at(&wk, i - 1), *next = priqueue_at(&wk, i);
+		if (*prev > *next || (*prev == *next && prev > next))
+			in_order = 0;
+	}
+	printf("Keyed sorted window ordered, ties in offer order: %d (expected 1).\n", in_order);
+	priqueue_destroy(&wk);
+
+	/* Bulk construction and sorted bulk offers land where single offers would, ties included. */
+	void *sptrs[300];
+	for (i = 0; i < 300; i++)
+		sptrs[i] = &skeys[i];
+	priqueue_t fs, fk, fh, ss, sh;
+	priqueue_init_from_array(&fs, compare1, PRIQUEUE_SORTED, sptrs, 250);
+	priqueue_init_keyed(&fk, key1);
+	priqueue_offer_many(&fk, sptrs, 250);
+	priqueue_init_from_array(&fh, compare1, PRIQUEUE_HEAP, sptrs, 250);
+	priqueue_init(&ss, compare1);
+	priqueue_init_mode(&sh, compare1, PRIQUEUE_HEAP);
+	for (i = 0; i < 250; i++)
+	{
+		priqueue_offer(&ss, sptrs[i]);
+		priqueue_offer(&sh, sptrs[i]);
+	}
+	priqueue_offer_many(&fs, sptrs + 250, 50); /* merged */
+	priqueue_offer_many(&fk, sptrs + 250, 50);
+	priqueue_offer_many(&fs, sptrs, 5); /* offered one by one */
+	priqueue_offer_many(&fk, sptrs, 5);
+	for (i = 250; i < 300; i++)
+		priqueue_offer(&ss, sptrs[i]);
+	for (i = 0; i < 5; i++)
+		priqueue_offer(&ss, sptrs[i]);
+	printf("Sorted bulk total elements: %d (expected 305).\n", priqueue_size(&fs));
+	in_order = 1;
+	key_order = 1;
+	for (i = 0; i < priqueue_size(&ss); i++)
+	{
+		if (priqueue_at(&fs, i) != priqueue_at(&ss, i))
+			in_order = 0;
+		if (priqueue_at(&fk, i) != priqueue_at(&ss, i))
+			key_order = 0;
+	}
+	printf("Sorted bulk in single offer order: %d (expected 1).\n", in_order);
+	printf("Keyed sorted bulk in single offer order: %d (expected 1).\n", key_order);
+	in_order = 1;
+	while (priqueue_size(&sh) > 0)
+		if (priqueue_poll(&fh) != priqueue_poll(&sh))
+			in_order = 0;
+	printf("Heap from array polled like single offers: %d (expected 1).\n", in_order);
+
+	priqueue_reserve(&sh, 300);
+	void **reserved = sh.m_array;
+	for (i = 0; i < 300; i++)
+		priqueue_offer(&sh, sptrs[i]);
+	printf("Reserved heap kept its storage: %d (expected 1).\n", sh.m_array == reserved);
+
+	priqueue_destroy(&sh);
+	priqueue_destroy(&ss);
+	priqueue_destroy(&fh);
+	priqueue_destroy(&fk);
+	priqueue_destroy(&fs);
+
 	free(values);
 
 	return 0;
@@ -7,38 +7,51 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
-#include <assert.h>
+#include <limits.h>
 
 #include "libscheduler/libscheduler.h"
+#include "libtrace/libtrace.h"
 
 
-typedef struct _simulator_job_list_t
+/*
+ * How much the simulator prints while it runs. VERBOSITY_SUMMARY prints the
+ * final timing diagram and averages only, VERBOSITY_EVENTS adds every
+ * arrival, completion and quantum expiry, and VERBOSITY_FULL (the default)
+ * adds the state of every core at the end of every time unit.
+ */
+typedef enum {VERBOSITY_SUMMARY = 0, VERBOSITY_EVENTS, VERBOSITY_FULL} verbosity_t;
+
+// Size of the stdout buffer; everything the simulator prints goes through it
+#define OUTPUT_BUFFER_SIZE (4 * 1024 * 1024)
+
+/*
+ * The timing diagram of a core, stored as runs of consecutive time units
+ * spent on the same job (job_id -1 when idle).
+ */
+typedef struct _simulator_interval_t
+{
+	int job_id, start, length;
+} simulator_interval_t;
+
+typedef struct _simulator_diagram_t
 {
-	int job_id, arrival_time, run_time, priority;
-	int core_id, arrived;
-} simulator_job_list_t;
+	simulator_interval_t *intervals;
+	int interval_ct, intervals_size;
+} simulator_diagram_t;
 
 void print_usage(char *program_name)
 {
-	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> <input file>\n", program_name);
+	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> [-e] [-w <start>:<end>] [-v <level>] [-p] <input file>\n", program_name);
 	fprintf(stderr, "       %s -c 2 -s fcfs examples/proc1.csv\n", program_name);
 	fprintf(stderr, "\n");
-	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#\n");
-}
-
-int set_active_job(int job_id, int core_id, simulator_job_list_t *jobs, int active_jobs)
-{
-	int i;
-	for (i = 0; i < active_jobs; i++)
-	{
-		if (jobs[i].job_id == job_id && jobs[i].arrived)
-		{
-			jobs[i].core_id = core_id;
-			return 1;
-		}
-	}
-
-	return 0;
+	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#, mlfq[#[,levels[,boost]]],\n");
+	fprintf(stderr, "                        cfs[granularity[,latency]], edf, pedf\n");
+	fprintf(stderr, "  -e  event-driven: skip straight to the next arrival, completion or\n");
+	fprintf(stderr, "      quantum expiry instead of simulating every time unit\n");
+	fprintf(stderr, "  -w  only draw time units start through end of the timing diagrams\n");
+	fprintf(stderr, "  -v  0: final diagram and averages only, 1: also every scheduling event,\n");
+	fprintf(stderr, "      2: also every time unit (default)\n");
+	fprintf(stderr, "  -p  also print min, max and percentiles of each latency\n");
 }
 
 void print_available_jobs(simulator_job_list_t *jobs, int active_jobs)
@@ -78,17 +91,273 @@ void print_available_cores(int cores)
 	}
 }
 
+/*
+ * Records that the core spent time_units units, starting at time, on job_id.
+ * Extends the last run when the job did not change.
+ */
+int diagram_append(simulator_diagram_t *diagram, int job_id, int time, int time_units)
+{
+	if (diagram->interval_ct > 0)
+	{
+		simulator_interval_t *last = &diagram->intervals[diagram->interval_ct - 1];
+
+		if (last->job_id == job_id && last->start + last->length == time)
+		{
+			last->length += time_units;
+			return 1;
+		}
+	}
+
+	if (diagram->interval_ct == diagram->intervals_size)
+	{
+		diagram->intervals_size = (diagram->intervals_size == 0) ? 64 : 2 * diagram->intervals_size;
+		diagram->intervals = realloc(diagram->intervals, diagram->intervals_size * sizeof(simulator_interval_t));
+
+		if (diagram->intervals == NULL)
+			return 0;
+	}
+
+	diagram->intervals[diagram->interval_ct].job_id = job_id;
+	diagram->intervals[diagram->interval_ct].start = time;
+	diagram->intervals[diagram->interval_ct].length = time_units;
+	diagram->interval_ct++;
+	return 1;
+}
+
+/*
+ * Writes the diagram's time units in [window_start, window_end) to stdout,
+ * one job label per unit, without building the whole string in memory.
+ */
+void print_diagram(simulator_diagram_t *diagram, int window_start, int window_end)
+{
+	int i, k;
+	char label[11];
+	char run[1024];
+
+	for (i = 0; i < diagram->interval_ct; i++)
+	{
+		simulator_interval_t *interval = &diagram->intervals[i];
+		int start = interval->start;
+		int end = interval->start + interval->length;
+
+		if (start < window_start)
+			start = window_start;
+		if (end > window_end)
+			end = window_end;
+		if (start >= end)
+			continue;
+
+		if (interval->job_id == -1)
+			strcpy(label, "-");
+		else if (interval->job_id < 10)
+			sprintf(label, "%d", interval->job_id);
+		else if (interval->job_id < 10 + 26)
+			sprintf(label, "%c", interval->job_id - 10 + 'a');
+		else if (interval->job_id < 10 + 26 + 26)
+			sprintf(label, "%c", interval->job_id - 10 - 26 + 'A');
+		else
+			snprintf(label, 10, "(%d)", interval->job_id);
+
+		// Write the run as whole chunks of repeated labels
+		size_t label_length = strlen(label);
+		int labels_per_run = sizeof(run) / label_length;
+		int units = end - start;
+
+		for (k = 0; k < labels_per_run && k < units; k++)
+			memcpy(run + k * label_length, label, label_length);
+
+		for (k = 0; k < units; k += labels_per_run)
+		{
+			int chunk = (units - k < labels_per_run) ? units - k : labels_per_run;
+			fwrite(run, label_length, chunk, stdout);
+		}
+	}
+}
+
+/*
+ * Parses a list of up to max_values integers separated by separator, with
+ * nothing else after them, into values. Returns how many there were, or -1
+ * if text is not such a list.
+ */
+int parse_ints(const char *text, char separator, int *values, int max_values)
+{
+	int count = 0;
+	const char *p = text;
+
+	while (1)
+	{
+		char *end;
+		long value = strtol(p, &end, 10);
+
+		if (end == p || count == max_values || value < INT_MIN || value > INT_MAX)
+			return -1;
+		values[count++] = (int)value;
+
+		if (*end == '\0')
+			return count;
+		if (*end != separator)
+			return -1;
+		p = end + 1;
+	}
+}
+
+/*
+ * Prints the header for the current time unit, once.
+ */
+void print_time_header(int time, int *time_header_printed)
+{
+	if (!*time_header_printed)
+	{
+		printf("=== [TIME %d] ===\n", time);
+		*time_header_printed = 1;
+	}
+}
+
+
+/*
+ * What the hooks below need while trace_run() runs the trace.
+ */
+typedef struct _simulator_t
+{
+	scheduler_t *scheduler;
+	int cores, verbosity, window_start, window_end;
+	int time_header_printed;
+	simulator_diagram_t *core_timing_diagram;
+} simulator_t;
+
+void on_step(void *arg, int time)
+{
+	simulator_t *sim = arg;
+
+	sim->time_header_printed = 0;
+	if (sim->verbosity >= VERBOSITY_FULL)
+		print_time_header(time, &sim->time_header_printed);
+}
+
+void on_finished(void *arg, int time, int job_id, int core_id, int new_job_id)
+{
+	simulator_t *sim = arg;
+
+	if (sim->verbosity >= VERBOSITY_EVENTS)
+	{
+		print_time_header(time, &sim->time_header_printed);
+		printf("Job %d, running on core %d, finished. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
+		printf("  Queue: "); scheduler_show_queue_r(sim->scheduler); printf("\n\n");
+	}
+}
+
+void on_expired(void *arg, int time, int job_id, int core_id, int new_job_id)
+{
+	simulator_t *sim = arg;
+
+	if (sim->verbosity >= VERBOSITY_EVENTS)
+	{
+		print_time_header(time, &sim->time_header_printed);
+		printf("Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
+		printf("  Queue: "); scheduler_show_queue_r(sim->scheduler); printf("\n\n");
+	}
+}
+
+void on_arrived(void *arg, int time, simulator_job_list_t *job, int core_id)
+{
+	simulator_t *sim = arg;
+
+	if (sim->verbosity >= VERBOSITY_EVENTS)
+	{
+		print_time_header(time, &sim->time_header_printed);
+		if (core_id != -1)
+			printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
+					job->job_id, job->run_time, job->priority, job->job_id, core_id);
+		else
+			printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
+					job->job_id, job->run_time, job->priority, job->job_id);
+		printf("  Queue: "); scheduler_show_queue_r(sim->scheduler); printf("\n\n");
+	}
+}
+
+/*
+ * Adds the units just run to the timing diagrams and, at full verbosity,
+ * prints them.
+ */
+int on_ran(void *arg, int time, int time_units, const int *core_job)
+{
+	simulator_t *sim = arg;
+	int i;
+
+	for (i = 0; i < sim->cores; i++)
+	{
+		if (!diagram_append(&sim->core_timing_diagram[i], core_job[i], time, time_units))
+		{
+			fprintf(stderr, "Out of memory.\n");
+			return 0;
+		}
+	}
+
+	if (sim->verbosity >= VERBOSITY_FULL)
+	{
+		printf("At the end of time unit %d...\n", time + time_units - 1);
+
+		for (i = 0; i < sim->cores; i++)
+		{
+			printf("  Core %2d: ", i);
+			print_diagram(&sim->core_timing_diagram[i], sim->window_start, sim->window_end);
+			printf("\n");
+		}
+
+		printf("\n");
+
+		printf("  Queue: ");
+		scheduler_show_queue_r(sim->scheduler);
+		printf("\n");
+		printf("\n");
+	}
+
+	return 1;
+}
+
+void on_invalid(void *arg, trace_status_t status, int value, simulator_job_list_t *jobs, int active_jobs)
+{
+	simulator_t *sim = arg;
+
+	switch (status)
+	{
+		case TRACE_INVALID_FINISHED_JOB:
+			printf("The scheduler_job_finished() selected an invalid job (job_id == %d).\n", value);
+			print_available_jobs(jobs, active_jobs);
+			break;
+
+		case TRACE_INVALID_EXPIRED_JOB:
+			printf("The scheduler_quantum_expired() selected an invalid job (job_id == %d).\n", value);
+			print_available_jobs(jobs, active_jobs);
+			break;
+
+		case TRACE_INVALID_CORE:
+			printf("The scheduler_new_jobs_batch() selected an invalid core (core_id == %d).\n", value);
+			print_available_cores(sim->cores);
+			break;
+
+		default:
+			printf("All cores are idle and at least one job remains unscheduled.\n");
+			print_available_jobs(jobs, active_jobs);
+			break;
+	}
+}
+
 
 int main(int argc, char **argv)
 {
 	int c;
-	int cores = 0, scheme = -1, quantum = 0;
+	int cores = 0, scheme = -1, quantum = 0, event_driven = 0;
+	int mlfq_levels = MLFQ_DEFAULT_LEVELS, mlfq_boost = MLFQ_DEFAULT_BOOST;
+	int cfs_latency = CFS_DEFAULT_LATENCY;
+	int window_start = 0, window_end = INT_MAX;
+	int verbosity = VERBOSITY_FULL, print_percentiles = 0;
 	char *file_name;
 
 	/*
 	 * Parse command line options.
 	 */
-	while ((c = getopt(argc, argv, "c:s:")) != -1)
+	while ((c = getopt(argc, argv, "c:s:ew:v:p")) != -1)
 	{
 		switch (c)
 		{
@@ -109,6 +378,41 @@ int main(int argc, char **argv)
 				else if (strcasecmp(optarg, "PSJF") == 0) { scheme = PSJF; }
 				else if (strcasecmp(optarg, "PRI") == 0) { scheme = PRI; }
 				else if (strcasecmp(optarg, "PPRI") == 0) { scheme = PPRI; }
+				else if (strcasecmp(optarg, "EDF") == 0) { scheme = EDF; }
+				else if (strcasecmp(optarg, "PEDF") == 0) { scheme = PEDF; }
+				else if (strncasecmp(optarg, "MLFQ", 4) == 0)
+				{
+					// Optional quantum, levels and boost period: mlfq[Q[,L[,B]]]
+					int spec[3] = { 1, mlfq_levels, mlfq_boost };
+
+					scheme = MLFQ;
+					if ((optarg[4] != '\0' && parse_ints(optarg + 4, ',', spec, 3) < 1) ||
+					    spec[0] <= 0 || spec[1] < 1 || spec[1] > MLFQ_MAX_LEVELS || spec[2] < 0)
+					{
+						fprintf(stderr, "Option -s MLFQ takes a positive quantum, 1 to %d levels and a boost period (0 for none). (Eg: -s MLFQ2,3,100)\n", MLFQ_MAX_LEVELS);
+						print_usage(argv[0]);
+						return 1;
+					}
+					quantum = spec[0];
+					mlfq_levels = spec[1];
+					mlfq_boost = spec[2];
+				}
+				else if (strncasecmp(optarg, "CFS", 3) == 0)
+				{
+					// Optional minimum granularity and target latency: cfs[G[,L]]
+					int spec[2] = { CFS_DEFAULT_GRANULARITY, cfs_latency };
+
+					scheme = CFS;
+					if ((optarg[3] != '\0' && parse_ints(optarg + 3, ',', spec, 2) < 1) ||
+					    spec[0] <= 0 || spec[1] < 0)
+					{
+						fprintf(stderr, "Option -s CFS takes a positive minimum granularity and a target latency. (Eg: -s CFS1,8)\n");
+						print_usage(argv[0]);
+						return 1;
+					}
+					quantum = spec[0];
+					cfs_latency = spec[1];
+				}
 				else if (strncasecmp(optarg, "RR", 2) == 0)
 				{
 					scheme = RR;
@@ -123,6 +427,47 @@ int main(int argc, char **argv)
 				}
 				break;
 
+			case 'e':
+				event_driven = 1;
+				break;
+
+			case 'w':
+			{
+				int window[2];
+
+				if (parse_ints(optarg, ':', window, 2) != 2 || window[0] < 0 || window[1] < window[0])
+				{
+					fprintf(stderr, "Option -w <start>:<end> requires 0 <= start <= end. (Eg: -w 100:200)\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				// Both ends are inclusive on the command line
+				window_start = window[0];
+				window_end = window[1];
+				if (window_end < INT_MAX)
+					window_end++;
+				break;
+			}
+
+			case 'p':
+				print_percentiles = 1;
+				break;
+
+			case 'v':
+			{
+				char *end;
+				long level = strtol(optarg, &end, 10);
+
+				if (end == optarg || *end != '\0' || level < VERBOSITY_SUMMARY || level > VERBOSITY_FULL)
+				{
+					fprintf(stderr, "Option -v <level> requires 0, 1 or 2.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				verbosity = (int)level;
+				break;
+			}
+
 			case '?':
 				print_usage(argv[0]);
 				return 1;
@@ -160,62 +505,18 @@ int main(int argc, char **argv)
 	/*
 	 * Open the file, read the file, and populate the jobs data structure.
 	 */
-	FILE *file = fopen(file_name, "r");
-	if (file == NULL)
-	{
-		fprintf(stderr, "Unable to open file \"%s\".\n", file_name);
-		return 2;
-	}
-
-
 	int job_id = 0;
-	int jobs_ct = 10;
-	simulator_job_list_t* jobs = malloc(jobs_ct * sizeof(simulator_job_list_t));
-
-	char line[1024 + 1];
-	fgets(line, 1024, file);  // Ignore the first (header) line
-	while (fgets(line, 1024, file) != NULL)
-	{
-		char *arrival_time = strtok(line, ",");
-		char *run_time = strtok(NULL, ",");
-		char *priority = strtok(NULL, ",");
-
-		if (arrival_time != NULL && run_time != NULL && priority != NULL)
-		{
-			if (job_id == jobs_ct)
-			{
-				jobs_ct *= 2;
-				jobs = realloc(jobs, jobs_ct * sizeof(simulator_job_list_t));
-
-				if (!jobs)
-				{
-					fprintf(stderr, "Out of memory.\n");
-					return 2;
-				}
-			}
-
-			jobs[job_id].job_id = job_id;
-			jobs[job_id].arrival_time = atoi(arrival_time);
-			jobs[job_id].run_time = atoi(run_time);
-			jobs[job_id].priority = atoi(priority);
-			jobs[job_id].core_id = -1;
-			jobs[job_id].arrived = 0;
-
-			job_id++;
-		}
-		else
-		{
-			fprintf(stderr, "Illegal file format.\n");
-			return 2;
-		}
-	}
+	simulator_job_list_t* jobs = load_jobs(file_name, &job_id);
 
-	fclose(file);
+	if (jobs == NULL)
+		return 2;
 
 
 	/*
 	 * Run the simulation.
 	 */
+	static char output_buffer[OUTPUT_BUFFER_SIZE];
+	setvbuf(stdout, output_buffer, _IOFBF, OUTPUT_BUFFER_SIZE);
 
 	printf("Loaded %d core(s) and %d job(s) using ", cores, job_id);
 	if (scheme == FCFS) { printf("First Come First Served (FCFS)"); }
@@ -224,268 +525,80 @@ int main(int argc, char **argv)
 	else if (scheme == PRI) { printf("Non-preemptive Priority (PRI)"); }
 	else if (scheme == PPRI) { printf("Preemptive Priority (PPRI)"); }
 	else if (scheme == RR) { printf("Round Robin (RR) with a quantum of %d", quantum); }
+	else if (scheme == MLFQ) { printf("Multi-level Feedback Queue (MLFQ) with %d level(s), a quantum of %d doubling per level and a boost every %d", mlfq_levels, quantum, mlfq_boost); }
+	else if (scheme == CFS) { printf("Completely Fair Scheduler (CFS) with a minimum granularity of %d and a target latency of %d", quantum, cfs_latency); }
+	else if (scheme == EDF) { printf("Non-preemptive Earliest Deadline First (EDF)"); }
+	else if (scheme == PEDF) { printf("Preemptive Earliest Deadline First (PEDF)"); }
 	printf(" scheduling...\n\n");
 
-	scheduler_start_up(cores, scheme);
+	scheduler_t *scheduler = scheduler_create(cores, scheme);
+	if (scheme == MLFQ)
+		scheduler_mlfq_configure_r(scheduler, mlfq_levels, quantum, mlfq_boost);
+	else if (scheme == CFS)
+		scheduler_cfs_configure_r(scheduler, quantum, cfs_latency);
+	scheduler_reserve_jobs_r(scheduler, job_id);
+
+	int time, i;
+	simulator_arrival_t *arrivals = sort_arrivals(jobs, job_id);
+	simulator_diagram_t *core_timing_diagram = calloc(cores, sizeof(simulator_diagram_t));
 
+	simulator_t sim = { scheduler, cores, verbosity, window_start, window_end, 0, core_timing_diagram };
+	trace_hooks_t hooks = { &sim, on_step, on_finished, on_expired, on_arrived, on_ran, on_invalid };
 
-	int time = 0, i, j;
-	int active_jobs = job_id, jobs_alive = 0;
+	if (trace_run(scheduler, scheme, cores, quantum, event_driven, jobs, arrivals, job_id, &hooks, &time) != TRACE_OK)
+		return 3;
 
-	int *quantum_clock = malloc(cores * sizeof(int));
-	char **core_timing_diagram = malloc(cores * sizeof(char *));
-	int core_timing_diagram_size = 1024;
 
+	printf("FINAL TIMING DIAGRAM:\n");
 	for (i = 0; i < cores; i++)
 	{
-		quantum_clock[i] = -1;
-		core_timing_diagram[i] = malloc(core_timing_diagram_size + 1);
-		core_timing_diagram[i][0] = '\0';
+		printf("  Core %2d: ", i);
+		print_diagram(&core_timing_diagram[i], window_start, window_end);
+		printf("\n");
 	}
 
-	while (active_jobs > 0)
-	{
-		printf("=== [TIME %d] ===\n", time);
-
-		/*
-		 * 1. Check if any jobs finished in the last time unit.
-		 */
-		for (i = 0; i < active_jobs; i++)
-		{
-			if (jobs[i].run_time == 0)
-			{
-				// Notify the scheduler has finished
-				int job_id = jobs[i].job_id;
-				int core_id = jobs[i].core_id;
-				int new_job_id = scheduler_job_finished(jobs[i].core_id, jobs[i].job_id, time);
-
-				if (scheme == RR)
-					quantum_clock[jobs[i].core_id] = quantum;
-
-				// Delete the finished jobs, decrease the number of active jobs
-				if (i != active_jobs - 1)
-					memcpy(&jobs[i], &jobs[active_jobs - 1], sizeof(simulator_job_list_t));
-				active_jobs--;
-				jobs_alive--;
-				i--;
-
-				// Set the new job
-				if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs) )
-				{
-					printf("The scheduler_job_finished() selected an invalid job (job_id == %d).\n", new_job_id);
-					print_available_jobs(jobs, active_jobs);
-					return 3;
-				}
-				else
-				{
-					printf("Job %d, running on core %d, finished. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-				}
-			}
-		}
-
-		/*
-		 * Check to see if we finished our last job.  (If we don't check here, we would run an extra time unit that will be totally idle.)
-		 */
-		if (active_jobs == 0)
-			break;
-
-		/*
-		 * 2. Check of any quantums expired in the last time unit.
-		 */
-		if (scheme == RR)
-		{
-			for (i = 0; i < cores; i++)
-			{
-				if (quantum_clock[i] == 0)
-				{
-					for (j = 0; j < active_jobs; j++)
-					{
-						if (jobs[j].core_id == i)
-						{
-							// Notify the scheduler the quantum has expired
-							int core_id = jobs[j].core_id;
-							int old_job_id = jobs[j].job_id;
-							int new_job_id = scheduler_quantum_expired(jobs[j].core_id, time);
-
-							jobs[j].core_id = -1;
-
-							quantum_clock[core_id] = quantum;
-
-							// Set the new job
-							if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs) )
-							{
-								printf("The scheduler_quantum_expired() selected an invalid job (job_id == %d).\n", new_job_id);
-								print_available_jobs(jobs, active_jobs);
-								return 3;
-							}
-							else
-							{
-								printf("Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", old_job_id, core_id, core_id, new_job_id);
-								printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-							}
-
-							break;
-						}
-					}
-				}
-			}
-		}
-
-
-		/*
-		 * 3. Check for any new jobs that arrive in this time unit
-		 */
-		for (i = 0; i < active_jobs; i++)
-		{
-			if (jobs[i].arrival_time == time)
-			{
-				int new_job_core_id = scheduler_new_job(jobs[i].job_id, time, jobs[i].run_time, jobs[i].priority);
-				jobs[i].arrived = 1;
-				jobs_alive++;
-
-				if (new_job_core_id >= 0 && new_job_core_id < cores)
-				{
-					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
-							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id, new_job_core_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-
-					// Find if anyone is currently using the core.
-					for (j = 0; j < active_jobs; j++)
-						if (jobs[j].core_id == new_job_core_id)
-							jobs[j].core_id = -1;
-
-					// Assign the core to the new job
-					jobs[i].core_id = new_job_core_id;
-
-					if (scheme == RR)
-						quantum_clock[new_job_core_id] = quantum;
-				}
-				else if (new_job_core_id == -1)
-				{
-					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
-							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-				}
-				else
-				{
-					printf("The scheduler_new_job() selected an invalid core (core_id == %d).\n", new_job_core_id);
-					print_available_cores(cores);
-					return 3;
-				}
-			}
-		}
-
-
-		/*
-		 * 4. Run the time unit.
-		 */
-		char time_string[cores][11];
-		int cores_working = 0;
-
-		for (i = 0; i < cores; i++)
-			time_string[i][0] = '\0';
-
-		for (i = 0; i < active_jobs; i++)
-		{
-			if (jobs[i].core_id != -1)
-			{
-				cores_working++;
-				jobs[i].run_time--;
-				quantum_clock[jobs[i].core_id]--;
-
-				assert(time_string[jobs[i].core_id][0] == '\0');
-
-				if (jobs[i].job_id < 10)
-					sprintf(time_string[jobs[i].core_id], "%d", jobs[i].job_id);
-				else if (jobs[i].job_id < 10 + 26)
-					sprintf(time_string[jobs[i].core_id], "%c", jobs[i].job_id - 10 + 'a');
-				else if (jobs[i].job_id < 10 + 26 + 26)
-					sprintf(time_string[jobs[i].core_id], "%c", jobs[i].job_id - 10 - 26 + 'A');
-				else
-					snprintf(time_string[jobs[i].core_id], 10, "(%d)", jobs[i].job_id);
-			}
-		}
-
-		for (i = 0; i < cores; i++)
-		{
-			// If the core is idle, print a '-'
-			if (time_string[i][0] == '\0')
-				strcpy(time_string[i], "-");
-
-			// Ensure we have enough memory
-			while (strlen(core_timing_diagram[i]) + strlen(time_string[i]) >= (unsigned int)core_timing_diagram_size)
-			{
-				core_timing_diagram_size *= 2;
-
-				for (j = 0; j < cores; j++)
-				{
-					core_timing_diagram[j] = realloc(core_timing_diagram[j], core_timing_diagram_size + 1);
-
-					if (core_timing_diagram[j] == NULL)
-					{
-						fprintf(stderr, "Out of memory.\n");
-						return 3;
-					}
-				}
-			}
-
-			strcat( core_timing_diagram[i], time_string[i] );
-		}
-
-
-		/*
-		 * 5. Print data!
-		 */
-		printf("At the end of time unit %d...\n", time);
+	printf("\n");
+	printf("Average Waiting Time: %.2f\n", scheduler_average_waiting_time_r(scheduler));
+	printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time_r(scheduler));
+	printf("Average Response Time: %.2f\n", scheduler_average_response_time_r(scheduler));
 
-		for (i = 0; i < cores; i++)
-			printf("  Core %2d: %s\n", i, core_timing_diagram[i]);
+	/*
+	 * Deadlines are only reported for traces that have them, so the output
+	 * of other traces is unchanged.
+	 */
+	latency_stats_t lateness;
+	scheduler_latency_stats_r(scheduler, LATENCY_LATENESS, &lateness);
 
-		printf("\n");
+	if (lateness.count > 0)
+	{
+		int misses = scheduler_deadline_misses_r(scheduler);
 
-		printf("  Queue: ");
-		scheduler_show_queue();
-		printf("\n");
-		printf("\n");
+		printf("Deadline Misses: %d of %d (%.2f%%)\n", misses, lateness.count, 100.0 * misses / lateness.count);
+		printf("Lateness p50/p90/p99/max: %d/%d/%d/%d\n", lateness.p50, lateness.p90, lateness.p99, lateness.max);
+	}
 
+	if (print_percentiles)
+	{
+		const char *latency_names[] = { "Waiting Time", "Turnaround Time", "Response Time", "Lateness" };
+		latency_stats_t stats;
+		int last_latency = (lateness.count > 0) ? LATENCY_LATENESS : LATENCY_RESPONSE;
 
-		/*
-		 * 6. Sanity Checking
-		 *
-		 * - If there's a job alive (needing to be ran) and all CPUs are idle, the scheduler failed to schedule properly.
-		 */
-		if (jobs_alive > 0 && cores_working == 0)
+		printf("\n%-16s %10s %10s %10s %10s %10s %10s %10s\n", "", "mean", "min", "p50", "p90", "p99", "p99.9", "max");
+		for (i = LATENCY_WAITING; i <= last_latency; i++)
 		{
-			printf("All cores are idle and at least one job remains unscheduled.\n");
-			print_available_jobs(jobs, active_jobs);
-			return 3;
+			scheduler_latency_stats_r(scheduler, i, &stats);
+			printf("%-16s %10.2f %10d %10d %10d %10d %10d %10d\n", latency_names[i],
+					stats.mean, stats.min, stats.p50, stats.p90, stats.p99, stats.p999, stats.max);
 		}
-
-
-		/*
-		 * 7. Increase time
-		 */
-		time++;
 	}
 
-
-	printf("FINAL TIMING DIAGRAM:\n");
-	for (i = 0; i < cores; i++)
-		printf("  Core %2d: %s\n", i, core_timing_diagram[i]);
-
-	printf("\n");
-	printf("Average Waiting Time: %.2f\n", scheduler_average_waiting_time());
-	printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time());
-	printf("Average Response Time: %.2f\n", scheduler_average_response_time());
-
-	scheduler_clean_up();
+	scheduler_destroy(scheduler);
 
 
-	free(quantum_clock);
 	for (i=0; i < cores; i++)
-		free(core_timing_diagram[i]);
+		free(core_timing_diagram[i].intervals);
 	free(core_timing_diagram);
+	free(arrivals);
 	free(jobs);
 
 	return 0;
@@ -0,0 +1,412 @@
+/*
+ * Parameter sweep: loads one trace and runs it under every combination of
+ * scheme, core count and (for RR, MLFQ and CFS) quantum on a pool of
+ * threads, printing one results row per run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "libscheduler/libscheduler.h"
+#include "libtrace/libtrace.h"
+
+
+/*
+ * One point of the grid and, once it has run, its results.
+ */
+typedef struct _sweep_run_t
+{
+	int scheme, cores, quantum;
+
+	int ok; // 0 if the scheduler made an invalid decision
+	int makespan;
+	double utilization;
+	int misses; // jobs that finished after their deadline
+	latency_stats_t stats[4];
+} sweep_run_t;
+
+/*
+ * Shared by the worker threads. Everything except next_run is read-only
+ * while they run.
+ */
+typedef struct _sweep_t
+{
+	simulator_job_list_t *jobs;
+	simulator_arrival_t *arrivals;
+	int job_count;
+	long long total_run_time;
+
+	sweep_run_t *runs;
+	int run_count;
+
+	int next_run; // next grid point to hand out, under lock
+	pthread_mutex_t lock;
+} sweep_t;
+
+static const char *scheme_names[] = { "fcfs", "sjf", "psjf", "pri", "ppri", "rr", "mlfq", "cfs", "edf", "pedf" };
+
+void print_usage(char *program_name)
+{
+	fprintf(stderr, "Usage: %s -c <cores,...> [-s <scheme,...>] [-q <quantum,...>] [-t <threads>] [-f csv|json] <input file>\n", program_name);
+	fprintf(stderr, "       %s -c 1,2,4,8 -s fcfs,rr -q 1,2,4 examples/proc1.csv\n", program_name);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr, mlfq, cfs, edf, pedf\n");
+	fprintf(stderr, "                        (default: all of them)\n");
+	fprintf(stderr, "  -q  quanta to run rr with, level 0 quanta for mlfq and minimum granularities\n");
+	fprintf(stderr, "      for cfs (default: 1)\n");
+	fprintf(stderr, "  -t  number of worker threads (default: one per online processor)\n");
+	fprintf(stderr, "  -f  format of the results matrix (default: csv)\n");
+}
+
+/*
+ * Parses a comma separated list of positive integers into a new array.
+ * Returns the number of values, or 0 if the list is not valid.
+ */
+int parse_list(const char *list, int **values)
+{
+	int count = 1;
+	const char *p;
+
+	for (p = list; *p; p++)
+		if (*p == ',')
+			count++;
+
+	*values = malloc(count * sizeof(int));
+
+	int i;
+	for (i = 0, p = list; i < count; i++)
+	{
+		char *end;
+		long value = strtol(p, &end, 10);
+
+		if (end == p || value <= 0 || value > 1 << 20 || (*end != ',' && *end != '\0'))
+		{
+			free(*values);
+			*values = NULL;
+			return 0;
+		}
+
+		(*values)[i] = (int)value;
+		p = end + 1;
+	}
+
+	return count;
+}
+
+/*
+ * Runs the trace under one grid point, event-driven and without printing,
+ * the same way `simulator -e` does.
+ */
+void sweep_run(sweep_t *sweep, sweep_run_t *run)
+{
+	int cores = run->cores, scheme = run->scheme, quantum = run->quantum;
+	int total_jobs = sweep->job_count, time, i;
+
+	simulator_job_list_t *jobs = malloc(total_jobs * sizeof(simulator_job_list_t));
+	memcpy(jobs, sweep->jobs, total_jobs * sizeof(simulator_job_list_t));
+
+	scheduler_t *scheduler = scheduler_create(cores, scheme);
+	scheduler_reserve_jobs_r(scheduler, total_jobs);
+	if (scheme == MLFQ)
+		scheduler_mlfq_configure_r(scheduler, MLFQ_DEFAULT_LEVELS, quantum, MLFQ_DEFAULT_BOOST);
+	else if (scheme == CFS)
+		scheduler_cfs_configure_r(scheduler, quantum, CFS_DEFAULT_LATENCY * quantum);
+
+	run->ok = (trace_run(scheduler, scheme, cores, quantum, 1, jobs, sweep->arrivals, total_jobs, NULL, &time) == TRACE_OK);
+
+	run->makespan = time;
+	run->utilization = (time > 0) ? (double)sweep->total_run_time / ((double)time * cores) : 0.0;
+	run->misses = scheduler_deadline_misses_r(scheduler);
+	for (i = LATENCY_WAITING; i <= LATENCY_LATENESS; i++)
+		scheduler_latency_stats_r(scheduler, i, &run->stats[i]);
+
+	scheduler_destroy(scheduler);
+
+	free(jobs);
+}
+
+/*
+ * Worker thread: takes grid points until there are none left.
+ */
+void *sweep_worker(void *arg)
+{
+	sweep_t *sweep = arg;
+
+	while (1)
+	{
+		pthread_mutex_lock(&sweep->lock);
+		int run = sweep->next_run++;
+		pthread_mutex_unlock(&sweep->lock);
+
+		if (run >= sweep->run_count)
+			break;
+
+		sweep_run(sweep, &sweep->runs[run]);
+	}
+
+	return NULL;
+}
+
+/*
+ * Share of the jobs with a deadline that missed it, 0 if none had one.
+ */
+double miss_ratio(sweep_run_t *run)
+{
+	int deadline_jobs = run->stats[LATENCY_LATENESS].count;
+	return (deadline_jobs > 0) ? (double)run->misses / deadline_jobs : 0.0;
+}
+
+void print_csv(sweep_t *sweep)
+{
+	const char *latency_names[] = { "waiting", "turnaround", "response", "lateness" };
+	int i, l;
+
+	printf("scheme,cores,quantum,jobs,ok,makespan,utilization,misses,miss_ratio");
+	for (l = LATENCY_WAITING; l <= LATENCY_LATENESS; l++)
+		printf(",%s_mean,%s_min,%s_p50,%s_p90,%s_p99,%s_p999,%s_max", latency_names[l], latency_names[l],
+				latency_names[l], latency_names[l], latency_names[l], latency_names[l], latency_names[l]);
+	printf("\n");
+
+	for (i = 0; i < sweep->run_count; i++)
+	{
+		sweep_run_t *run = &sweep->runs[i];
+
+		printf("%s,%d,%d,%d,%d,%d,%.4f,%d,%.4f", scheme_names[run->scheme], run->cores, run->quantum,
+				sweep->job_count, run->ok, run->makespan, run->utilization, run->misses, miss_ratio(run));
+		for (l = LATENCY_WAITING; l <= LATENCY_LATENESS; l++)
+		{
+			latency_stats_t *stats = &run->stats[l];
+			printf(",%.2f,%d,%d,%d,%d,%d,%d", stats->mean, stats->min, stats->p50,
+					stats->p90, stats->p99, stats->p999, stats->max);
+		}
+		printf("\n");
+	}
+}
+
+void print_json(sweep_t *sweep)
+{
+	const char *latency_names[] = { "waiting", "turnaround", "response", "lateness" };
+	int i, l;
+
+	printf("[\n");
+	for (i = 0; i < sweep->run_count; i++)
+	{
+		sweep_run_t *run = &sweep->runs[i];
+
+		printf("  {\"scheme\": \"%s\", \"cores\": %d, \"quantum\": %d, \"jobs\": %d, \"ok\": %s, \"makespan\": %d, \"utilization\": %.4f,"
+				" \"misses\": %d, \"miss_ratio\": %.4f",
+				scheme_names[run->scheme], run->cores, run->quantum, sweep->job_count,
+				run->ok ? "true" : "false", run->makespan, run->utilization, run->misses, miss_ratio(run));
+		for (l = LATENCY_WAITING; l <= LATENCY_LATENESS; l++)
+		{
+			latency_stats_t *stats = &run->stats[l];
+			printf(",\n   \"%s\": {\"mean\": %.2f, \"min\": %d, \"p50\": %d, \"p90\": %d, \"p99\": %d, \"p999\": %d, \"max\": %d}",
+					latency_names[l], stats->mean, stats->min, stats->p50, stats->p90, stats->p99, stats->p999, stats->max);
+		}
+		printf("}%s\n", (i == sweep->run_count - 1) ? "" : ",");
+	}
+	printf("]\n");
+}
+
+
+int main(int argc, char **argv)
+{
+	int c, i, j, k;
+	int *core_list = NULL, core_ct = 0;
+	int *quantum_list = NULL, quantum_ct = 0;
+	int scheme_list[PEDF + 1], scheme_ct = 0;
+	int threads = 0, json = 0;
+	char *file_name;
+
+	while ((c = getopt(argc, argv, "c:s:q:t:f:")) != -1)
+	{
+		switch (c)
+		{
+			case 'c':
+				free(core_list);
+				core_ct = parse_list(optarg, &core_list);
+
+				if (core_ct == 0)
+				{
+					fprintf(stderr, "Option -c <cores,...> requires a list of positive numbers.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 's':
+			{
+				char *list = strdup(optarg), *saveptr = NULL, *name;
+
+				scheme_ct = 0;
+				for (name = strtok_r(list, ",", &saveptr); name != NULL; name = strtok_r(NULL, ",", &saveptr))
+				{
+					for (k = 0; k <= PEDF; k++)
+						if (strcasecmp(name, scheme_names[k]) == 0)
+							break;
+
+					if (k > PEDF)
+					{
+						fprintf(stderr, "Unknown scheme \"%s\".\n", name);
+						print_usage(argv[0]);
+						free(list);
+						return 1;
+					}
+
+					// Each scheme once, in the order given
+					for (j = 0; j < scheme_ct && scheme_list[j] != k; j++)
+						;
+					if (j == scheme_ct)
+						scheme_list[scheme_ct++] = k;
+				}
+				free(list);
+				break;
+			}
+
+			case 'q':
+				free(quantum_list);
+				quantum_ct = parse_list(optarg, &quantum_list);
+
+				if (quantum_ct == 0)
+				{
+					fprintf(stderr, "Option -q <quantum,...> requires a list of positive numbers.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 't':
+				threads = atoi(optarg);
+
+				if (threads <= 0)
+				{
+					fprintf(stderr, "Option -t <threads> requires a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'f':
+				if (strcasecmp(optarg, "csv") == 0) { json = 0; }
+				else if (strcasecmp(optarg, "json") == 0) { json = 1; }
+				else
+				{
+					fprintf(stderr, "Option -f requires csv or json.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (core_ct == 0)
+	{
+		fprintf(stderr, "Required option -c <cores,...> is not present.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (optind == argc - 1)
+		file_name = argv[optind];
+	else
+	{
+		fprintf(stderr, "A single input file is required.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (scheme_ct == 0)
+		for (scheme_ct = 0; scheme_ct <= PEDF; scheme_ct++)
+			scheme_list[scheme_ct] = scheme_ct;
+
+	if (quantum_ct == 0)
+	{
+		quantum_list = malloc(sizeof(int));
+		quantum_list[0] = 1;
+		quantum_ct = 1;
+	}
+
+
+	/*
+	 * Load the trace once; every run works on its own copy of the jobs.
+	 */
+	sweep_t sweep;
+	sweep.jobs = load_jobs(file_name, &sweep.job_count);
+
+	if (sweep.jobs == NULL)
+		return 2;
+
+	sweep.arrivals = sort_arrivals(sweep.jobs, sweep.job_count);
+	sweep.total_run_time = 0;
+	for (i = 0; i < sweep.job_count; i++)
+		sweep.total_run_time += sweep.jobs[i].run_time;
+
+
+	/*
+	 * Lay out the grid: scheme, then cores, then quantum (RR, MLFQ and CFS only).
+	 */
+	sweep.run_count = 0;
+	sweep.runs = malloc(scheme_ct * core_ct * quantum_ct * sizeof(sweep_run_t));
+
+	for (i = 0; i < scheme_ct; i++)
+	{
+		for (j = 0; j < core_ct; j++)
+		{
+			for (k = 0; k < quantum_ct; k++)
+			{
+				int quantum_scheme = (scheme_list[i] == RR || scheme_list[i] == MLFQ || scheme_list[i] == CFS);
+				if (!quantum_scheme && k > 0)
+					break;
+
+				sweep_run_t *run = &sweep.runs[sweep.run_count++];
+				memset(run, 0, sizeof(*run));
+				run->scheme = scheme_list[i];
+				run->cores = core_list[j];
+				run->quantum = quantum_scheme ? quantum_list[k] : 0;
+			}
+		}
+	}
+
+
+	/*
+	 * Run the grid on the thread pool.
+	 */
+	if (threads == 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads > sweep.run_count)
+		threads = sweep.run_count;
+	if (threads < 1)
+		threads = 1;
+
+	pthread_t *workers = malloc(threads * sizeof(pthread_t));
+	sweep.next_run = 0;
+	pthread_mutex_init(&sweep.lock, NULL);
+
+	for (i = 0; i < threads; i++)
+		pthread_create(&workers[i], NULL, sweep_worker, &sweep);
+	for (i = 0; i < threads; i++)
+		pthread_join(workers[i], NULL);
+
+	pthread_mutex_destroy(&sweep.lock);
+
+	if (json)
+		print_json(&sweep);
+	else
+		print_csv(&sweep);
+
+	free(workers);
+	free(sweep.runs);
+	free(sweep.arrivals);
+	free(sweep.jobs);
+	free(core_list);
+	free(quantum_list);
+
+	return 0;
+}
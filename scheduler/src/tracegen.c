@@ -0,0 +1,423 @@
+/*
+ * Synthetic trace generator. Writes jobs in the simulator's CSV format to
+ * stdout, drawing arrivals, run times and priorities from configurable
+ * distributions. The same seed always gives the same trace, and jobs are
+ * streamed out as they are drawn so traces of 10^8 jobs need no memory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+
+// Size of the stdout buffer the trace is formatted into
+#define OUTPUT_BUFFER_SIZE (4 * 1024 * 1024)
+
+// Most priority levels -p weights:... can describe
+#define MAX_PRIORITY_LEVELS 64
+
+typedef enum {ARRIVAL_POISSON = 0, ARRIVAL_MMPP, ARRIVAL_DIURNAL} arrival_process_t;
+typedef enum {RUNTIME_EXPONENTIAL = 0, RUNTIME_PARETO, RUNTIME_BIMODAL} runtime_distribution_t;
+typedef enum {PRIORITY_UNIFORM = 0, PRIORITY_WEIGHTS} priority_mix_t;
+
+/*
+ * Everything the command line configures.
+ *
+ * Arrivals (rates are jobs per time unit):
+ *   poisson:RATE                    exponential gaps
+ *   mmpp:LOW,HIGH,MEAN_STAY         two-state Markov-modulated Poisson: bursts
+ *                                   at HIGH, calm at LOW, switching after an
+ *                                   exponential stay of MEAN_STAY time units
+ *   diurnal:RATE,AMPLITUDE,PERIOD   rate RATE * (1 + AMPLITUDE * sin(2 pi t / PERIOD))
+ *
+ * Run times (at least 1 time unit):
+ *   exp:MEAN
+ *   pareto:ALPHA,MIN                heavy tailed, P(X > x) = (MIN / x)^ALPHA
+ *   bimodal:SHORT,LONG,P_LONG       exponential around SHORT or LONG
+ *
+ * Priorities:
+ *   uniform:LOW,HIGH                every value in [LOW, HIGH] equally likely
+ *   weights:W0,W1,...               priority i with probability Wi / sum(W)
+ */
+typedef struct _tracegen_config_t
+{
+	arrival_process_t arrival;
+	double arrival_params[3];
+
+	runtime_distribution_t runtime;
+	double runtime_params[3];
+
+	priority_mix_t priority;
+	int priority_low, priority_high;
+	double priority_cdf[MAX_PRIORITY_LEVELS];
+	int priority_levels;
+} tracegen_config_t;
+
+
+/*
+ * xoshiro256** seeded through splitmix64.
+ */
+static unsigned long long rng_state[4];
+
+static unsigned long long rotl(unsigned long long x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+void rng_seed(unsigned long long seed)
+{
+	int i;
+	for (i = 0; i < 4; i++)
+	{
+		unsigned long long z = (seed += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		rng_state[i] = z ^ (z >> 31);
+	}
+}
+
+unsigned long long rng_next()
+{
+	unsigned long long result = rotl(rng_state[1] * 5, 7) * 9;
+	unsigned long long t = rng_state[1] << 17;
+
+	rng_state[2] ^= rng_state[0];
+	rng_state[3] ^= rng_state[1];
+	rng_state[1] ^= rng_state[2];
+	rng_state[0] ^= rng_state[3];
+	rng_state[2] ^= t;
+	rng_state[3] = rotl(rng_state[3], 45);
+
+	return result;
+}
+
+// uniform in (0, 1], so its log is always finite
+double rng_uniform()
+{
+	return ((rng_next() >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+double rng_exponential(double mean)
+{
+	return -mean * log(rng_uniform());
+}
+
+
+/*
+ * Gap from the arrival at time now to the next one. mmpp_high and
+ * mmpp_left carry the MMPP's state between calls.
+ */
+double next_gap(tracegen_config_t *config, double now, int *mmpp_high, double *mmpp_left)
+{
+	double *p = config->arrival_params;
+
+	if (config->arrival == ARRIVAL_POISSON)
+		return rng_exponential(1.0 / p[0]);
+
+	if (config->arrival == ARRIVAL_MMPP)
+	{
+		// Exponential gaps are memoryless, so when the state switches
+		// before the next arrival the rest of the gap is redrawn at the
+		// new rate
+		double gap = 0.0;
+		while (1)
+		{
+			double rate = *mmpp_high ? p[1] : p[0];
+			double candidate = rng_exponential(1.0 / rate);
+
+			if (candidate <= *mmpp_left)
+			{
+				*mmpp_left -= candidate;
+				return gap + candidate;
+			}
+
+			gap += *mmpp_left;
+			*mmpp_high = !*mmpp_high;
+			*mmpp_left = rng_exponential(p[2]);
+		}
+	}
+
+	// Diurnal: thin a Poisson process at the peak rate
+	double peak = p[0] * (1.0 + fabs(p[1]));
+	double t = now;
+	while (1)
+	{
+		t += rng_exponential(1.0 / peak);
+		double rate = p[0] * (1.0 + p[1] * sin(2.0 * M_PI * t / p[2]));
+		if (rng_uniform() * peak <= rate)
+			return t - now;
+	}
+}
+
+int next_runtime(tracegen_config_t *config)
+{
+	double *p = config->runtime_params;
+	double value;
+
+	if (config->runtime == RUNTIME_EXPONENTIAL)
+		value = rng_exponential(p[0]);
+	else if (config->runtime == RUNTIME_PARETO)
+		value = p[1] / pow(rng_uniform(), 1.0 / p[0]);
+	else
+		value = rng_exponential((rng_uniform() <= p[2]) ? p[1] : p[0]);
+
+	if (value > INT_MAX / 2)
+		value = INT_MAX / 2;
+	return (value < 1.0) ? 1 : (int)ceil(value);
+}
+
+int next_priority(tracegen_config_t *config)
+{
+	if (config->priority == PRIORITY_UNIFORM)
+		return config->priority_low + (int)(rng_next() % (unsigned long long)(config->priority_high - config->priority_low + 1));
+
+	double u = rng_uniform();
+	int i;
+	for (i = 0; i < config->priority_levels - 1; i++)
+		if (u <= config->priority_cdf[i])
+			break;
+	return i;
+}
+
+
+/*
+ * Splits "name:a,b,c" into name and up to max_params numbers. Returns the
+ * number of parameters, or -1 if the text is not of that form.
+ */
+int parse_spec(const char *spec, char *name, size_t name_size, double *params, int max_params)
+{
+	const char *colon = strchr(spec, ':');
+	if (colon == NULL || (size_t)(colon - spec) >= name_size)
+		return -1;
+
+	memcpy(name, spec, colon - spec);
+	name[colon - spec] = '\0';
+
+	int count = 0;
+	const char *p = colon + 1;
+	while (1)
+	{
+		char *end;
+		double value = strtod(p, &end);
+		if (end == p || count == max_params)
+			return -1;
+
+		params[count++] = value;
+		if (*end == '\0')
+			return count;
+		if (*end != ',')
+			return -1;
+		p = end + 1;
+	}
+}
+
+// Appends value and a terminator to the line being built
+static char *format_int(char *out, long long value, char terminator)
+{
+	char digits[24];
+	int length = 0;
+
+	if (value < 0)
+	{
+		*out++ = '-';
+		value = -value;
+	}
+	do
+	{
+		digits[length++] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+
+	while (length > 0)
+		*out++ = digits[--length];
+	*out++ = terminator;
+	return out;
+}
+
+void print_usage(char *program_name)
+{
+	fprintf(stderr, "Usage: %s -n <jobs> [-S <seed>] [-a <arrivals>] [-r <run times>] [-p <priorities>]\n", program_name);
+	fprintf(stderr, "       %s -n 1000000 -a mmpp:0.05,1,500 -r pareto:1.5,2 -p uniform:0,9 > trace.csv\n", program_name);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "  -a  poisson:RATE (default poisson:0.1), mmpp:LOW,HIGH,MEAN_STAY,\n");
+	fprintf(stderr, "      diurnal:RATE,AMPLITUDE,PERIOD; rates are jobs per time unit\n");
+	fprintf(stderr, "  -r  exp:MEAN (default exp:10), pareto:ALPHA,MIN, bimodal:SHORT,LONG,P_LONG\n");
+	fprintf(stderr, "  -p  uniform:LOW,HIGH (default uniform:1,5), weights:W0,W1,...\n");
+	fprintf(stderr, "  -S  seed (default 1); the same seed and options give the same trace\n");
+}
+
+int main(int argc, char **argv)
+{
+	int c, i;
+	long long job_count = -1;
+	unsigned long long seed = 1;
+	char name[16];
+	double params[MAX_PRIORITY_LEVELS];
+	int count;
+
+	tracegen_config_t config;
+	memset(&config, 0, sizeof(config));
+	config.arrival = ARRIVAL_POISSON;
+	config.arrival_params[0] = 0.1;
+	config.runtime = RUNTIME_EXPONENTIAL;
+	config.runtime_params[0] = 10.0;
+	config.priority = PRIORITY_UNIFORM;
+	config.priority_low = 1;
+	config.priority_high = 5;
+
+	while ((c = getopt(argc, argv, "n:S:a:r:p:")) != -1)
+	{
+		char *end;
+
+		errno = 0;
+		switch (c)
+		{
+			case 'n':
+				job_count = strtoll(optarg, &end, 10);
+				if (end == optarg || *end != '\0' || errno == ERANGE || job_count < 0)
+				{
+					fprintf(stderr, "Option -n <jobs> requires a non-negative number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'S':
+				// strtoull() would quietly negate a leading minus sign
+				seed = strtoull(optarg, &end, 0);
+				if (end == optarg || *end != '\0' || errno == ERANGE || strchr(optarg, '-') != NULL)
+				{
+					fprintf(stderr, "Option -S <seed> requires a non-negative number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'a':
+				count = parse_spec(optarg, name, sizeof(name), params, 3);
+				if (count == 1 && strcmp(name, "poisson") == 0 && params[0] > 0)
+					config.arrival = ARRIVAL_POISSON;
+				else if (count == 3 && strcmp(name, "mmpp") == 0 && params[0] > 0 && params[1] > 0 && params[2] > 0)
+					config.arrival = ARRIVAL_MMPP;
+				else if (count == 3 && strcmp(name, "diurnal") == 0 && params[0] > 0 && fabs(params[1]) <= 1 && params[2] > 0)
+					config.arrival = ARRIVAL_DIURNAL;
+				else
+				{
+					fprintf(stderr, "Invalid arrival process \"%s\".\n", optarg);
+					print_usage(argv[0]);
+					return 1;
+				}
+				memcpy(config.arrival_params, params, count * sizeof(double));
+				break;
+
+			case 'r':
+				count = parse_spec(optarg, name, sizeof(name), params, 3);
+				if (count == 1 && strcmp(name, "exp") == 0 && params[0] > 0)
+					config.runtime = RUNTIME_EXPONENTIAL;
+				else if (count == 2 && strcmp(name, "pareto") == 0 && params[0] > 0 && params[1] > 0)
+					config.runtime = RUNTIME_PARETO;
+				else if (count == 3 && strcmp(name, "bimodal") == 0 && params[0] > 0 && params[1] > 0 && params[2] >= 0 && params[2] <= 1)
+					config.runtime = RUNTIME_BIMODAL;
+				else
+				{
+					fprintf(stderr, "Invalid run time distribution \"%s\".\n", optarg);
+					print_usage(argv[0]);
+					return 1;
+				}
+				memcpy(config.runtime_params, params, count * sizeof(double));
+				break;
+
+			case 'p':
+				count = parse_spec(optarg, name, sizeof(name), params, MAX_PRIORITY_LEVELS);
+				if (count == 2 && strcmp(name, "uniform") == 0 && params[0] <= params[1])
+				{
+					config.priority = PRIORITY_UNIFORM;
+					config.priority_low = (int)params[0];
+					config.priority_high = (int)params[1];
+				}
+				else if (count >= 1 && strcmp(name, "weights") == 0)
+				{
+					double total = 0;
+					for (i = 0; i < count; i++)
+						total += (params[i] > 0) ? params[i] : 0;
+
+					if (total <= 0)
+						count = -1;
+					else
+					{
+						double running = 0;
+						config.priority = PRIORITY_WEIGHTS;
+						config.priority_levels = count;
+						for (i = 0; i < count; i++)
+						{
+							running += (params[i] > 0) ? params[i] : 0;
+							config.priority_cdf[i] = running / total;
+						}
+					}
+				}
+				else
+					count = -1;
+
+				if (count == -1)
+				{
+					fprintf(stderr, "Invalid priority mix \"%s\".\n", optarg);
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (job_count == -1)
+	{
+		fprintf(stderr, "Required option -n <jobs> is not present.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+
+	/*
+	 * Draw and write the jobs one at a time.
+	 */
+	static char output_buffer[OUTPUT_BUFFER_SIZE];
+	setvbuf(stdout, output_buffer, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+	rng_seed(seed);
+
+	int mmpp_high = 0;
+	double mmpp_left = (config.arrival == ARRIVAL_MMPP) ? rng_exponential(config.arrival_params[2]) : 0.0;
+	double now = 0.0;
+	long long job;
+
+	fputs("\"Arrival time\",\"Run time\",\"Priority\"\n", stdout);
+
+	for (job = 0; job < job_count; job++)
+	{
+		char line[64], *end = line;
+
+		if (job > 0)
+			now += next_gap(&config, now, &mmpp_high, &mmpp_left);
+
+		if (now > INT_MAX)
+		{
+			fprintf(stderr, "Arrival times passed %d after %lld jobs; use a higher arrival rate.\n", INT_MAX, job);
+			return 2;
+		}
+
+		end = format_int(end, (long long)now, ',');
+		end = format_int(end, next_runtime(&config), ',');
+		end = format_int(end, next_priority(&config), '\n');
+		fwrite(line, 1, end - line, stdout);
+	}
+
+	fflush(stdout);
+	return 0;
+}